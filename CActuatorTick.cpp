@@ -0,0 +1,173 @@
+/*
+ * CActuatorTick.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CActuatorTick.h"
+#include "CPwmRegistry.h"
+#include <sys/timerfd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+CActuatorTick actuator_tick(&pwm_registry);
+
+static uint64_t monotonic_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+CActuatorTick::CActuatorTick(CPwmRegistry *registry) :
+    registry_(registry) {
+}
+
+bool CActuatorTick::start(uint32_t rate_hz, int priority, bool lock_memory) {
+  if (isTicking() || (0 == rate_hz)) {
+    return false;
+  }
+  rate_hz_ = rate_hz;
+  period_ns_ = 1000000000ull / rate_hz;
+  priority_ = priority;
+  //timer is set up here, failure leaves boards with their writers
+  fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (0 > fd_) {
+    perror("timerfd_create");
+    return false;
+  }
+  //absolute deadlines, wake up lateness is measured against them
+  first_ns_ = monotonic_ns() + period_ns_;
+  itimerspec spec { };
+  spec.it_value.tv_sec = first_ns_ / 1000000000ull;
+  spec.it_value.tv_nsec = first_ns_ % 1000000000ull;
+  spec.it_interval.tv_sec = period_ns_ / 1000000000ull;
+  spec.it_interval.tv_nsec = period_ns_ % 1000000000ull;
+  if (0 != timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr)) {
+    perror("timerfd_settime");
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  if (lock_memory && (0 != mlockall(MCL_CURRENT | MCL_FUTURE))) {
+    perror("mlockall"); //not fatal, page faults possible
+  }
+  resetStats();
+  if (registry_) {
+    registry_->setTickOwner(true);
+  }
+  execute_.store(true, std::memory_order_release);
+  thd_ = std::thread(&CActuatorTick::tick_function, this);
+  return true;
+}
+
+bool CActuatorTick::startStepped(uint32_t rate_hz) {
+  if (isTicking() || (0 == rate_hz)) {
+    return false;
+  }
+  rate_hz_ = rate_hz;
+  period_ns_ = 1000000000ull / rate_hz;
+  resetStats();
+  if (registry_) {
+    registry_->setTickOwner(true);
+  }
+  stepped_.store(true, std::memory_order_release);
+  return true;
+}
+
+void CActuatorTick::stop() {
+  const auto stepped = stepped_.exchange(false, std::memory_order_acq_rel);
+  const auto running = execute_.exchange(false, std::memory_order_acq_rel);
+  if (thd_.joinable()) {
+    thd_.join();
+  }
+  if (0 <= fd_) {
+    close(fd_);
+    fd_ = -1;
+  }
+  if ((stepped || running) && registry_) {
+    registry_->setTickOwner(false);
+  }
+}
+
+void CActuatorTick::tick_function() {
+  if (priority_) {
+    sched_param param { };
+    param.sched_priority = priority_;
+    const auto err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err) {
+      cerr << "actuator tick SCHED_FIFO " << priority_ << " failed err=" << err << endl;
+    }
+  }
+  uint64_t expired_total = 0;
+  while (execute_.load(std::memory_order_acquire)) {
+    uint64_t expirations = 0;
+    if (sizeof(expirations) != read(fd_, &expirations, sizeof(expirations))) {
+      continue; //EINTR
+    }
+    const auto woken_ns = monotonic_ns();
+    expired_total += expirations;
+    const auto deadline_ns = first_ns_ + (expired_total - 1) * period_ns_;
+    const auto jitter_ns = static_cast<uint32_t>(woken_ns - deadline_ns);
+    if (1 < expirations) {
+      overruns_.fetch_add(expirations - 1, std::memory_order_relaxed);
+    }
+    step(static_cast<float>(expirations * period_ns_) / 1e9f);
+
+    const auto work_ns = static_cast<uint32_t>(monotonic_ns() - woken_ns);
+    ticks_.fetch_add(1, std::memory_order_relaxed);
+    jitter_sum_ns_.fetch_add(jitter_ns, std::memory_order_relaxed);
+    //single writer, plain max
+    if (jitter_ns > jitter_max_ns_.load(std::memory_order_relaxed)) {
+      jitter_max_ns_.store(jitter_ns, std::memory_order_relaxed);
+    }
+    if (work_ns > work_max_ns_.load(std::memory_order_relaxed)) {
+      work_max_ns_.store(work_ns, std::memory_order_relaxed);
+    }
+  }
+}
+
+void CActuatorTick::step(float dt) {
+  for (const auto &handler : handlers_) {
+    handler(dt);
+  }
+  if (registry_) {
+    registry_->service();
+  }
+}
+
+uint32_t CActuatorTick::getJitterAvgNs() const {
+  const auto ticks = getTicks();
+  return ticks ? jitter_sum_ns_.load(std::memory_order_relaxed) / ticks : 0;
+}
+
+void CActuatorTick::resetStats() {
+  ticks_.store(0, std::memory_order_relaxed);
+  overruns_.store(0, std::memory_order_relaxed);
+  jitter_sum_ns_.store(0, std::memory_order_relaxed);
+  jitter_max_ns_.store(0, std::memory_order_relaxed);
+  work_max_ns_.store(0, std::memory_order_relaxed);
+}
+
+void tick_bench() {
+  //wake up jitter at typical rates, normal and real time scheduling
+  for (const auto priority : { 0, 50 }) {
+    for (const auto rate_hz : { 50u, 200u, 1000u }) {
+      CActuatorTick tick(nullptr); //timer only, global boards may be not initialised
+      tick.start(rate_hz, priority);
+      this_thread::sleep_for(chrono::seconds(2));
+      tick.stop();
+      cout << "tick " << (priority ? "fifo" : "normal") << " rate=" << rate_hz << "Hz ticks=" << tick.getTicks()
+          << " overruns=" << tick.getOverruns() << " jitter avg=" << tick.getJitterAvgNs() / 1000 << "us max="
+          << tick.getJitterMaxNs() / 1000 << "us work max=" << tick.getWorkMaxNs() / 1000 << "us" << endl;
+    }
+  }
+}
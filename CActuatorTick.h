@@ -0,0 +1,93 @@
+/*
+ * CActuatorTick.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CACTUATORTICK_H_
+#define CACTUATORTICK_H_
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+
+class CPwmRegistry;
+
+/***
+ * fixed rate actuator loop: timerfd wakes thread every period,
+ * tick handlers step actuator targets, then pending pca9685 frame is written once.
+ * Optional SCHED_FIFO priority and mlockall for predictable latency.
+ */
+class CActuatorTick {
+public:
+  //dt: seconds since previous tick, missed ticks included
+  using handler_t = std::function<void(float dt)>;
+private:
+  CPwmRegistry *const registry_;
+  uint32_t rate_hz_ = 0;
+  uint64_t period_ns_ = 0;
+  int priority_ = 0;
+  int fd_ = -1; //timerfd, armed by start
+  uint64_t first_ns_ = 0; //first deadline
+  std::vector<handler_t> handlers_;
+  std::atomic<bool> execute_ { false };
+  std::atomic<bool> stepped_ { false };
+  std::thread thd_;
+
+  std::atomic<uint32_t> ticks_ { 0 };
+  std::atomic<uint32_t> overruns_ { 0 }; //expirations missed
+  std::atomic<uint64_t> jitter_sum_ns_ { 0 };
+  std::atomic<uint32_t> jitter_max_ns_ { 0 };
+  std::atomic<uint32_t> work_max_ns_ { 0 };
+  void tick_function();
+public:
+  //registry: boards flushed each tick, nullptr - handlers only
+  explicit CActuatorTick(CPwmRegistry *registry);
+  ~CActuatorTick() {
+    stop();
+  }
+  //handlers are added before start
+  void add(const handler_t &handler) {
+    handlers_.push_back(handler);
+  }
+  //priority: SCHED_FIFO priority, 0 - normal scheduling
+  bool start(uint32_t rate_hz, int priority = 0, bool lock_memory = false);
+  //no thread, caller steps ticks: replay steps them by recorded time
+  bool startStepped(uint32_t rate_hz);
+  void stop();
+  //handlers and frame write in caller thread
+  void step(float dt);
+  bool isRunning() const {
+    return execute_.load(std::memory_order_acquire);
+  }
+  //handlers are stepped, by own thread or by caller
+  bool isTicking() const {
+    return isRunning() || stepped_.load(std::memory_order_acquire);
+  }
+  uint32_t getRate() const {
+    return rate_hz_;
+  }
+  uint32_t getTicks() const {
+    return ticks_.load(std::memory_order_relaxed);
+  }
+  uint32_t getOverruns() const {
+    return overruns_.load(std::memory_order_relaxed);
+  }
+  //wake up after timer expiration
+  uint32_t getJitterAvgNs() const;
+  uint32_t getJitterMaxNs() const {
+    return jitter_max_ns_.load(std::memory_order_relaxed);
+  }
+  //handlers and frame write
+  uint32_t getWorkMaxNs() const {
+    return work_max_ns_.load(std::memory_order_relaxed);
+  }
+  void resetStats();
+};
+
+extern CActuatorTick actuator_tick;
+
+void tick_bench();
+#endif /* CACTUATORTICK_H_ */
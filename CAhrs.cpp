@@ -0,0 +1,272 @@
+/*
+ * CAhrs.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CAhrs.h"
+#include <math.h>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+CAhrs ahrs;
+
+constexpr float CAhrs::default_beta;
+constexpr float CAhrs::accel_tolerance;
+
+//large gain until first estimate settles, start orientation is unknown
+static constexpr float warmup_beta = 2.5f;
+static constexpr uint32_t warmup_updates = 200;
+static constexpr float deg_to_rad = static_cast<float>(M_PI) / 180;
+
+static float inv_norm(const float *v, size_t size) {
+  float sum = 0;
+  for (size_t idx = 0; idx < size; idx++) {
+    sum += v[idx] * v[idx];
+  }
+  return (0 < sum) ? 1 / sqrtf(sum) : 0;
+}
+
+void CAhrs::reset() {
+  q_[0] = 1;
+  q_[1] = q_[2] = q_[3] = 0;
+  updates_.store(0, std::memory_order_relaxed);
+  no_mag_.store(0, std::memory_order_relaxed);
+  accel_rejected_.store(0, std::memory_order_relaxed);
+  error_.store(0, std::memory_order_relaxed);
+}
+
+void CAhrs::update(const float gyro[3], const float accel[3], const float mag[3], float dt) {
+  const float q0 = q_[0], q1 = q_[1], q2 = q_[2], q3 = q_[3];
+  const float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+  //rate of change from gyro, q * (0, gyro) / 2
+  float q_dot[4] = { -q1 * gx - q2 * gy - q3 * gz, q0 * gx + q2 * gz - q3 * gy, q0 * gy - q1 * gz + q3 * gx, q0 * gz
+      + q1 * gy - q2 * gx };
+  for (auto idx = 0; idx < 4; idx++) {
+    q_dot[idx] *= 0.5f;
+  }
+
+  float a[3] = { accel[0], accel[1], accel[2] };
+  const auto a_inv = inv_norm(a, 3);
+  const auto updates = updates_.load(std::memory_order_relaxed);
+  //accel is gravity only when robot does not accelerate
+  if ((0 == a_inv) || (fabsf(1 / a_inv - 1) > accel_tolerance)) {
+    accel_rejected_.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    for (auto idx = 0; idx < 3; idx++) {
+      a[idx] *= a_inv;
+    }
+    const float ax = a[0], ay = a[1], az = a[2];
+    const float _2q0 = 2 * q0, _2q1 = 2 * q1, _2q2 = 2 * q2, _2q3 = 2 * q3;
+    const float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+    const float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3, q1q2 = q1 * q2, q1q3 = q1 * q3, q2q3 = q2 * q3;
+    //objective function: predicted minus measured gravity
+    const float fg_x = 2 * (q1q3 - q0q2) - ax;
+    const float fg_y = 2 * (q0q1 + q2q3) - ay;
+    const float fg_z = 1 - 2 * (q1q1 + q2q2) - az;
+    float error = fg_x * fg_x + fg_y * fg_y + fg_z * fg_z;
+    float m[3] = { 0, 0, 0 };
+    const auto m_inv = mag ? inv_norm(mag, 3) : 0;
+    float s[4];
+    if (0 < m_inv) {
+      for (auto idx = 0; idx < 3; idx++) {
+        m[idx] = mag[idx] * m_inv;
+      }
+      const float mx = m[0], my = m[1], mz = m[2];
+      const float _2q0mx = _2q0 * mx, _2q0my = _2q0 * my, _2q0mz = _2q0 * mz, _2q1mx = _2q1 * mx;
+      //earth field direction: horizontal along x, vertical along z
+      const float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2
+          - mx * q3q3;
+      const float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3
+          - my * q3q3;
+      const float _2bx = sqrtf(hx * hx + hy * hy);
+      const float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2
+          + mz * q3q3;
+      const float _4bx = 2 * _2bx, _4bz = 2 * _2bz;
+      //and field
+      const float fb_x = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+      const float fb_y = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+      const float fb_z = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+      error += fb_x * fb_x + fb_y * fb_y + fb_z * fb_z;
+      //gradient, jacobian transposed times objective
+      s[0] = -_2q2 * fg_x + _2q1 * fg_y - _2bz * q2 * fb_x + (-_2bx * q3 + _2bz * q1) * fb_y + _2bx * q2 * fb_z;
+      s[1] = _2q3 * fg_x + _2q0 * fg_y - 4 * q1 * fg_z + _2bz * q3 * fb_x + (_2bx * q2 + _2bz * q0) * fb_y
+          + (_2bx * q3 - _4bz * q1) * fb_z;
+      s[2] = -_2q0 * fg_x + _2q3 * fg_y - 4 * q2 * fg_z + (-_4bx * q2 - _2bz * q0) * fb_x + (_2bx * q1 + _2bz * q3)
+          * fb_y + (_2bx * q0 - _4bz * q2) * fb_z;
+      s[3] = _2q1 * fg_x + _2q2 * fg_y + (-_4bx * q3 + _2bz * q1) * fb_x + (-_2bx * q0 + _2bz * q2) * fb_y
+          + _2bx * q1 * fb_z;
+    } else {
+      no_mag_.fetch_add(1, std::memory_order_relaxed);
+      const float _4q0 = 4 * q0, _4q1 = 4 * q1, _4q2 = 4 * q2, _8q1 = 8 * q1, _8q2 = 8 * q2;
+      s[0] = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+      s[1] = _4q1 * q3q3 - _2q3 * ax + 4 * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+      s[2] = 4 * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+      s[3] = 4 * q1q1 * q3 - _2q1 * ax + 4 * q2q2 * q3 - _2q2 * ay;
+    }
+    const auto beta = (updates < warmup_updates) ? warmup_beta : beta_;
+    const auto s_inv = inv_norm(s, 4);
+    for (auto idx = 0; idx < 4; idx++) {
+      q_dot[idx] -= beta * s[idx] * s_inv;
+    }
+    error_.store(sqrtf(error), std::memory_order_relaxed);
+  }
+
+  //4 lane loops, vectorized on NEON
+  float q[4];
+  for (auto idx = 0; idx < 4; idx++) {
+    q[idx] = q_[idx] + q_dot[idx] * dt;
+  }
+  const auto q_inv = inv_norm(q, 4);
+  for (auto idx = 0; idx < 4; idx++) {
+    q_[idx] = q[idx] * q_inv;
+  }
+  updates_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CAhrs::update(const record_imu_t &raw, float accel_sens, float gyro_sens, float dt) {
+  const auto gyro_scale = deg_to_rad / gyro_sens;
+  const float gyro[3] = { raw.gyro[0] * gyro_scale, raw.gyro[1] * gyro_scale, raw.gyro[2] * gyro_scale };
+  const float accel[3] = { raw.accel[0] / accel_sens, raw.accel[1] / accel_sens, raw.accel[2] / accel_sens };
+  //AK8963: x is accel y, y is accel x, z points down
+  const float mag[3] = { static_cast<float>(raw.mag[1]), static_cast<float>(raw.mag[0]), -static_cast<float>(raw.mag[2]) };
+  const auto has_mag = (0 != raw.mag[0]) || (0 != raw.mag[1]) || (0 != raw.mag[2]);
+  update(gyro, accel, has_mag ? mag : nullptr, dt);
+}
+
+void CAhrs::quat_to_euler(const float q[4], float &yaw, float &pitch, float &roll) {
+  yaw = atan2f(2 * (q[0] * q[3] + q[1] * q[2]), 1 - 2 * (q[2] * q[2] + q[3] * q[3]));
+  pitch = asinf(fmaxf(-1, fminf(1, 2 * (q[0] * q[2] - q[3] * q[1]))));
+  roll = atan2f(2 * (q[0] * q[1] + q[2] * q[3]), 1 - 2 * (q[1] * q[1] + q[2] * q[2]));
+}
+
+static float wrap_pi(float angle) {
+  while (angle > static_cast<float>(M_PI)) {
+    angle -= 2 * static_cast<float>(M_PI);
+  }
+  while (angle < -static_cast<float>(M_PI)) {
+    angle += 2 * static_cast<float>(M_PI);
+  }
+  return angle;
+}
+
+void ahrs_bench() {
+  //level robot turning with slow yaw swing, field 20 uT north 40 uT down as in sim
+  constexpr auto rate_hz = 1000;
+  constexpr auto seconds = 60;
+  constexpr float dt = 1.f / rate_hz;
+  vector<record_imu_t> samples(rate_hz * seconds);
+  vector<float> truth(samples.size());
+  float yaw = 0;
+  for (size_t idx = 0; idx < samples.size(); idx++) {
+    const auto t = idx * dt;
+    const auto yaw_rate = 30 * sinf(2 * static_cast<float>(M_PI) * t / 20);
+    yaw += yaw_rate * dt * deg_to_rad;
+    truth[idx] = yaw;
+    auto &s = samples[idx];
+    const int16_t noise = static_cast<int16_t>(idx * 7 % 11) - 5;
+    s.accel[0] = noise;
+    s.accel[1] = -noise;
+    s.accel[2] = static_cast<int16_t>(16384 + noise);
+    s.gyro[0] = noise;
+    s.gyro[1] = noise;
+    s.gyro[2] = static_cast<int16_t>(yaw_rate * 16.4f + noise);
+    //body field, then AK8963 axes
+    const auto bx = 133 * cosf(yaw), by = -133 * sinf(yaw), bz = -267.f;
+    s.mag[0] = static_cast<int16_t>(by);
+    s.mag[1] = static_cast<int16_t>(bx);
+    s.mag[2] = static_cast<int16_t>(-bz);
+  }
+  for (const auto with_mag : { true, false }) {
+    CAhrs filter;
+    if (!with_mag) {
+      for (auto &s : samples) {
+        s.mag[0] = s.mag[1] = s.mag[2] = 0;
+      }
+    }
+    float err_max = 0;
+    float err_sum = 0;
+    size_t err_count = 0;
+    const auto started = chrono::steady_clock::now();
+    for (size_t idx = 0; idx < samples.size(); idx++) {
+      filter.update(samples[idx], 16384, 16.4f, dt);
+      if (idx >= rate_hz * 5) { //settled
+        float yaw_f, pitch, roll;
+        filter.getEuler(yaw_f, pitch, roll);
+        const auto err = fabsf(wrap_pi(yaw_f - truth[idx]));
+        err_max = max(err_max, err);
+        err_sum += err;
+        err_count++;
+      }
+    }
+    const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    cout << "ahrs " << (with_mag ? "9 axis" : "6 axis") << " updates=" << samples.size() << " " << ns / samples.size()
+        << "ns/update " << static_cast<uint64_t>(samples.size() * 1e9 / ns) << " updates/s yaw err avg="
+        << err_sum / err_count / deg_to_rad << "deg max=" << err_max / deg_to_rad << "deg" << endl;
+  }
+}
+
+bool ahrs_compare(const string &file, float accel_sens, float gyro_sens, float beta, ostream &os) {
+  //DMP quaternion has its own start heading, yaw is compared as change since settle
+  constexpr uint64_t settle_us = 5000000;
+  CAhrs filter;
+  filter.setBeta(beta);
+  uint64_t first_us = 0;
+  uint64_t prev_us = 0;
+  size_t samples = 0;
+  size_t compared = 0;
+  bool have_offset = false;
+  float yaw_offset = 0;
+  float err_sum[3] = { 0, 0, 0 };
+  float err_max[3] = { 0, 0, 0 };
+  const auto ok = CFlightRecorder::read(file, [&](const record_t &rec) {
+    if (rec_imu != rec.type) {
+      return;
+    }
+    if (0 == first_us) {
+      first_us = prev_us = rec.time_us;
+    }
+    const auto dt = (rec.time_us > prev_us) ? (rec.time_us - prev_us) / 1e6f : 0.f;
+    prev_us = rec.time_us;
+    filter.update(rec.imu, accel_sens, gyro_sens, fminf(dt, 0.1f));
+    samples++;
+    if ((rec.time_us - first_us < settle_us) || (0 == rec.imu.quat[0])) {
+      return;
+    }
+    float dmp_q[4];
+    for (auto idx = 0; idx < 4; idx++) {
+      dmp_q[idx] = rec.imu.quat[idx] / static_cast<float>(1 << 30);
+    }
+    float dmp[3];
+    float est[3];
+    CAhrs::quat_to_euler(dmp_q, dmp[0], dmp[1], dmp[2]);
+    filter.getEuler(est[0], est[1], est[2]);
+    if (!have_offset) {
+      yaw_offset = wrap_pi(est[0] - dmp[0]);
+      have_offset = true;
+    }
+    dmp[0] += yaw_offset;
+    for (auto axis = 0; axis < 3; axis++) {
+      const auto err = fabsf(wrap_pi(est[axis] - dmp[axis]));
+      err_sum[axis] += err;
+      err_max[axis] = max(err_max[axis], err);
+    }
+    compared++;
+  });
+  if (!ok) {
+    return false;
+  }
+  os << "imu samples=" << samples << " compared=" << compared << " no mag=" << filter.getNoMag()
+      << " accel rejected=" << filter.getAccelRejected() << endl;
+  const char *axes[] = { "yaw", "pitch", "roll" };
+  for (auto axis = 0; axis < 3; axis++) {
+    os << axes[axis] << " ahrs-dmp avg=" << (compared ? err_sum[axis] / compared / deg_to_rad : 0) << "deg max="
+        << err_max[axis] / deg_to_rad << "deg" << endl;
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+ * CAhrs.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CAHRS_H_
+#define CAHRS_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <atomic>
+#include "CFlightRecorder.h"
+
+/***
+ * Madgwick 9 axis orientation filter on raw gyro, accel and mag.
+ * Quaternion maps sensor frame to earth frame (x - magnetic north, z - up).
+ * Without mag or with implausible accel, step falls back to gyro and accel or gyro only.
+ * Called by one thread, diagnostics can be read by any.
+ */
+class CAhrs {
+  float beta_;
+  float q_[4] = { 1, 0, 0, 0 }; //w x y z
+  std::atomic<uint32_t> updates_ { 0 };
+  std::atomic<uint32_t> no_mag_ { 0 };
+  std::atomic<uint32_t> accel_rejected_ { 0 };
+  std::atomic<float> error_ { 0 }; //last objective norm, measured vs predicted unit vectors
+public:
+  static constexpr float default_beta = 0.1f;
+  static constexpr float accel_tolerance = 0.25f; //g away from 1 g, accel is not gravity
+  CAhrs(float beta = default_beta) :
+      beta_(beta) {
+  }
+  void setBeta(float beta) {
+    beta_ = beta;
+  }
+  float getBeta() const {
+    return beta_;
+  }
+  void reset();
+  //gyro rad/s, accel g, mag any unit, sensor frame; mag nullptr - 6 axis
+  void update(const float gyro[3], const float accel[3], const float mag[3], float dt);
+  //raw MPU-9250 sample, AK8963 axes are aligned to accel and gyro, zero mag - no mag
+  void update(const record_imu_t &raw, float accel_sens, float gyro_sens, float dt);
+  void getQuaternion(float q[4]) const {
+    for (auto idx = 0; idx < 4; idx++) {
+      q[idx] = q_[idx];
+    }
+  }
+  //rad, yaw about z, pitch about y, roll about x
+  void getEuler(float &yaw, float &pitch, float &roll) const {
+    quat_to_euler(q_, yaw, pitch, roll);
+  }
+  static void quat_to_euler(const float q[4], float &yaw, float &pitch, float &roll);
+  uint32_t getUpdates() const {
+    return updates_.load(std::memory_order_relaxed);
+  }
+  uint32_t getNoMag() const {
+    return no_mag_.load(std::memory_order_relaxed);
+  }
+  uint32_t getAccelRejected() const {
+    return accel_rejected_.load(std::memory_order_relaxed);
+  }
+  float getError() const {
+    return error_.load(std::memory_order_relaxed);
+  }
+};
+
+extern CAhrs ahrs;
+
+void ahrs_bench();
+//runs filter with given gain over imu records of flight recorder file and compares with DMP quaternion
+bool ahrs_compare(const std::string &file, float accel_sens, float gyro_sens, float beta, std::ostream &os);
+#endif /* CAHRS_H_ */
@@ -0,0 +1,353 @@
+/*
+ * CAnimator.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CAnimator.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+static constexpr char clip_magic[4] = { 'R', 'C', 'K', 'F' };
+static constexpr uint16_t clip_version = 1;
+static const string clip_extension = ".anim";
+
+CAnimator animator(pwm_registry);
+
+bool CAnimClip::add(uint16_t channel, const vector<anim_key_t> &keys) {
+  if (keys.empty()) {
+    return false;
+  }
+  for (size_t idx = 1; idx < keys.size(); idx++) {
+    if (keys[idx].t_ms <= keys[idx - 1].t_ms) {
+      return false;
+    }
+  }
+  channel_.push_back(channel);
+  for (const auto &key : keys) {
+    time_.push_back(key.t_ms / 1000.f);
+    value_.push_back(key.value);
+    easing_.push_back((ease_in_out < key.easing) ? static_cast<uint8_t>(ease_linear) : key.easing);
+  }
+  first_.push_back(time_.size());
+  duration_ = max(duration_, time_.back());
+  return true;
+}
+
+uint16_t CAnimClip::getChannels() const {
+  return channel_.empty() ? 0 : *max_element(channel_.begin(), channel_.end()) + 1;
+}
+
+bool CAnimClip::load(const string &file) {
+  ifstream is(file, ios::binary);
+  file_header_t header;
+  if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, clip_magic,
+      sizeof(clip_magic)) || (clip_version != header.version)) {
+    return false;
+  }
+  CAnimClip clip;
+  for (uint16_t track = 0; track < header.tracks; track++) {
+    file_track_t file_track;
+    if (!is.read(reinterpret_cast<char*>(&file_track), sizeof(file_track))) {
+      return false;
+    }
+    vector<anim_key_t> keys(file_track.keys);
+    if (!is.read(reinterpret_cast<char*>(keys.data()), keys.size() * sizeof(anim_key_t))
+        || !clip.add(file_track.channel, keys)) {
+      return false;
+    }
+  }
+  *this = clip;
+  return true;
+}
+
+bool CAnimClip::save(const string &file) const {
+  ofstream os(file, ios::binary | ios::trunc);
+  file_header_t header;
+  memcpy(header.magic, clip_magic, sizeof(header.magic));
+  header.version = clip_version;
+  header.tracks = channel_.size();
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (size_t track = 0; track < channel_.size(); track++) {
+    const file_track_t file_track { channel_[track], static_cast<uint16_t>(first_[track + 1] - first_[track]) };
+    os.write(reinterpret_cast<const char*>(&file_track), sizeof(file_track));
+    for (auto idx = first_[track]; idx < first_[track + 1]; idx++) {
+      const anim_key_t key { static_cast<uint32_t>(lroundf(time_[idx] * 1000)), static_cast<uint16_t>(value_[idx]),
+          easing_[idx], 0 };
+      os.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    }
+  }
+  return static_cast<bool>(os);
+}
+
+void CAnimator::resize(uint16_t channels) {
+  if (acc_value_.size() >= channels) {
+    return;
+  }
+  acc_value_.resize(channels, 0);
+  acc_weight_.resize(channels, 0);
+  out_.resize(channels, 0);
+  known_.resize(channels, 0);
+  changed_.reserve(channels);
+}
+
+void CAnimator::add(const string &name, const CAnimClip &clip) {
+  auto shared = make_shared<const CAnimClip>(clip);
+  lock_guard<mutex> guard(mu_);
+  resize(clip.getChannels());
+  for (auto &entry : clips_) {
+    if (entry.first == name) { //playing copy is kept until stopped
+      entry.second = shared;
+      return;
+    }
+  }
+  clips_.emplace_back(name, shared);
+}
+
+size_t CAnimator::load(const string &folder) {
+  folder_ = folder;
+  auto dir = opendir(folder.c_str());
+  if (!dir) {
+    perror(folder.c_str());
+    return 0;
+  }
+  size_t loaded = 0;
+  for (auto entry = readdir(dir); entry; entry = readdir(dir)) {
+    const string file = entry->d_name;
+    if ((file.size() <= clip_extension.size())
+        || (0 != file.compare(file.size() - clip_extension.size(), clip_extension.size(), clip_extension))) {
+      continue;
+    }
+    CAnimClip clip;
+    if (!clip.load(folder + "/" + file)) {
+      cerr << "wrong animation clip " << file << endl;
+      continue;
+    }
+    add(file.substr(0, file.size() - clip_extension.size()), clip);
+    loaded++;
+  }
+  closedir(dir);
+  return loaded;
+}
+
+vector<string> CAnimator::getClips() const {
+  vector<string> names;
+  lock_guard<mutex> guard(mu_);
+  for (const auto &entry : clips_) {
+    names.push_back(entry.first);
+  }
+  return names;
+}
+
+bool CAnimator::play(const string &name, bool loop, uint32_t fade_ms, float speed) {
+  lock_guard<mutex> guard(mu_);
+  const auto clip = find_if(clips_.begin(), clips_.end(), [&](const decltype(clips_)::value_type &entry) {
+    return entry.first == name;
+  });
+  if ((clips_.end() == clip) || (0 >= speed)) {
+    return false;
+  }
+  auto playback = find_if(playing_.begin(), playing_.end(), [&](const playback_t &entry) {
+    return entry.name == name;
+  });
+  if (playing_.end() == playback) {
+    playing_.push_back(playback_t());
+    playback = playing_.end() - 1;
+    playback->weight = 0;
+  }
+  playback->name = name;
+  playback->clip = clip->second;
+  playback->time = 0;
+  playback->speed = speed;
+  playback->loop = loop;
+  playback->fade_rate = fade_ms ? 1000.f / fade_ms : 1e9f;
+  playback->cursor.assign(clip->second->first_.begin(), clip->second->first_.end() - 1);
+  return true;
+}
+
+void CAnimator::stop(const string &name, uint32_t fade_ms) {
+  lock_guard<mutex> guard(mu_);
+  for (auto &playback : playing_) {
+    if (("" == name) || (playback.name == name)) {
+      playback.fade_rate = fade_ms ? -1000.f / fade_ms : -1e9f;
+    }
+  }
+}
+
+vector<CAnimator::playing_t> CAnimator::getPlaying() const {
+  vector<playing_t> playing;
+  lock_guard<mutex> guard(mu_);
+  for (const auto &playback : playing_) {
+    playing.push_back( { playback.name, playback.time, playback.clip->getDuration(), playback.weight, playback.loop });
+  }
+  return playing;
+}
+
+static inline float ease(uint8_t easing, float u) {
+  switch (easing) {
+  case ease_step:
+    return 0;
+  case ease_in:
+    return u * u;
+  case ease_out:
+    return u * (2 - u);
+  case ease_in_out:
+    return u * u * (3 - 2 * u);
+  default:
+    return u;
+  }
+}
+
+void CAnimator::sample(playback_t &playback) {
+  const auto &clip = *playback.clip;
+  const auto t = playback.time;
+  const auto weight = playback.weight;
+  const auto tracks = clip.channel_.size();
+  for (size_t track = 0; track < tracks; track++) {
+    const auto last = clip.first_[track + 1] - 1;
+    auto key = playback.cursor[track];
+    while ((key < last) && (clip.time_[key + 1] <= t)) {
+      key++;
+    }
+    playback.cursor[track] = key;
+    auto value = clip.value_[key];
+    if ((key < last) && (t > clip.time_[key])) {
+      const auto u = (t - clip.time_[key]) / (clip.time_[key + 1] - clip.time_[key]);
+      value += (clip.value_[key + 1] - value) * ease(clip.easing_[key + 1], u);
+    }
+    const auto channel = clip.channel_[track];
+    acc_value_[channel] += weight * value;
+    acc_weight_[channel] += weight;
+  }
+}
+
+size_t CAnimator::evaluate(float dt) {
+  lock_guard<mutex> guard(mu_);
+  return advance(dt);
+}
+
+size_t CAnimator::advance(float dt) {
+  changed_.clear();
+  if (playing_.empty()) {
+    return 0;
+  }
+  fill(acc_value_.begin(), acc_value_.end(), 0.f);
+  fill(acc_weight_.begin(), acc_weight_.end(), 0.f);
+  for (auto &playback : playing_) {
+    playback.weight = max(0.f, min(1.f, playback.weight + playback.fade_rate * dt));
+    playback.time += dt * playback.speed;
+    const auto duration = playback.clip->getDuration();
+    if (playback.time >= duration) {
+      if (playback.loop && (0 < duration)) {
+        playback.time = fmodf(playback.time, duration);
+        playback.cursor.assign(playback.clip->first_.begin(), playback.clip->first_.end() - 1);
+      } else {
+        playback.time = duration;
+      }
+    }
+    sample(playback);
+  }
+  //faded out and finished clips leave, their last output stays
+  playing_.erase(remove_if(playing_.begin(), playing_.end(), [](const playback_t &playback) {
+    return ((0 > playback.fade_rate) && (0 >= playback.weight))
+        || (!playback.loop && (playback.time >= playback.clip->getDuration()));
+  }), playing_.end());
+
+  const auto channels = acc_weight_.size();
+  for (size_t channel = 0; channel < channels; channel++) {
+    const auto weight = acc_weight_[channel];
+    if (0 >= weight) {
+      continue;
+    }
+    const auto value = (known_[channel] && (1 > weight)) ? acc_value_[channel] + (1 - weight) * out_[channel] :
+        acc_value_[channel] / weight;
+    if (!known_[channel] || (lroundf(value) != lroundf(out_[channel]))) {
+      changed_.push_back(channel);
+    }
+    out_[channel] = value;
+    known_[channel] = 1;
+  }
+  return changed_.size();
+}
+
+void CAnimator::step(float dt) {
+  //outputs are read under lock too, clip added meanwhile reallocates them
+  lock_guard<mutex> guard(mu_);
+  if (0 == advance(dt)) {
+    return;
+  }
+  CPwmRegistry::Batch batch(dev_);
+  for (const auto channel : changed_) {
+    dev_.set(channel, static_cast<uint16_t>(lroundf(out_[channel])));
+  }
+}
+
+void animation_bench() {
+  constexpr auto rate_hz = 50;
+  constexpr auto dt = 1.f / rate_hz;
+  constexpr auto keys = 8;
+  constexpr auto ticks = 5000;
+  for (const uint16_t channels : { 16, 128, 256, 512 }) {
+    //gait and pose clips with different key times, crossfaded all the time
+    CAnimClip gait;
+    CAnimClip pose;
+    for (uint16_t channel = 0; channel < channels; channel++) {
+      vector<anim_key_t> gait_keys;
+      vector<anim_key_t> pose_keys;
+      for (auto key = 0; key < keys; key++) {
+        gait_keys.push_back( { static_cast<uint32_t>(key * 250 + channel % 7 * 10),
+            static_cast<uint16_t>(200 + (key + channel) % 3 * 100), static_cast<uint8_t>(key % 5), 0 });
+        pose_keys.push_back( { static_cast<uint32_t>(key * 400), static_cast<uint16_t>(300 + key % 2 * 50), ease_in_out,
+            0 });
+      }
+      gait.add(channel, gait_keys);
+      pose.add(channel, pose_keys);
+    }
+    const string file = "/tmp/animation_bench.anim";
+    CAnimClip loaded;
+    const auto round_trip = gait.save(file) && loaded.load(file) && (loaded.getKeys() == gait.getKeys());
+    ifstream is(file, ios::binary | ios::ate);
+    const auto file_bytes = static_cast<size_t>(is.tellg());
+    remove(file.c_str());
+
+    CPca9685 first(0, 0x40);
+    CPwmRegistry dev(first);
+    CAnimator anim(dev);
+    anim.add("gait", loaded);
+    anim.add("pose", pose);
+    anim.play("gait", true, 0);
+    anim.play("pose", true, 0);
+    size_t changed = 0;
+    uint64_t max_ns = 0;
+    const auto started = chrono::steady_clock::now();
+    for (auto tick = 0; tick < ticks; tick++) {
+      if (0 == tick % 100) { //pose weight goes up and down
+        if (tick % 200) {
+          anim.stop("pose", 1000);
+        } else {
+          anim.play("pose", true, 1000);
+        }
+      }
+      const auto tick_started = chrono::steady_clock::now();
+      changed += anim.evaluate(dt);
+      const uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - tick_started)
+          .count();
+      max_ns = max(max_ns, ns);
+    }
+    const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    const auto avg_ns = ns / ticks;
+    cout << "animation channels=" << channels << " keys=" << loaded.getKeys() << " file=" << file_bytes
+        << " bytes round trip=" << (round_trip ? "ok" : "failed") << " tick avg=" << avg_ns / 1000.f << "us max="
+        << max_ns / 1000 << "us changed=" << changed / ticks << "/tick headroom="
+        << 1e9f / rate_hz / max<uint64_t>(avg_ns, 1) << "x" << endl;
+  }
+}
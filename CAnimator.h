@@ -0,0 +1,143 @@
+/*
+ * CAnimator.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CANIMATOR_H_
+#define CANIMATOR_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "CPwmRegistry.h"
+
+enum easing_t : uint8_t {
+  ease_linear = 0,
+  ease_step, //holds previous value until key
+  ease_in, //quadratic
+  ease_out,
+  ease_in_out //smoothstep
+};
+
+//file record, easing is applied on segment which ends at key
+struct anim_key_t {
+  uint32_t t_ms;
+  uint16_t value; //pwm counts
+  uint8_t easing;
+  uint8_t reserved;
+};
+
+/***
+ * keyframe clip, tracks of one channel each. Keys of all tracks are kept in flat arrays,
+ * track is a range of them sorted by time.
+ * File: header, then per track channel, key count and keys.
+ */
+class CAnimClip {
+public:
+  struct file_header_t {
+    char magic[4];
+    uint16_t version;
+    uint16_t tracks;
+  };
+  struct file_track_t {
+    uint16_t channel;
+    uint16_t keys;
+  };
+private:
+  std::vector<uint16_t> channel_; //per track
+  std::vector<uint32_t> first_; //per track + 1, first key of track
+  std::vector<float> time_; //per key, s
+  std::vector<float> value_;
+  std::vector<uint8_t> easing_;
+  float duration_ = 0;
+  friend class CAnimator;
+public:
+  CAnimClip() {
+    first_.push_back(0);
+  }
+  //keys sorted by time
+  bool add(uint16_t channel, const std::vector<anim_key_t> &keys);
+  bool load(const std::string &file);
+  bool save(const std::string &file) const;
+  size_t getTracks() const {
+    return channel_.size();
+  }
+  size_t getKeys() const {
+    return time_.size();
+  }
+  float getDuration() const {
+    return duration_;
+  }
+  //highest channel + 1
+  uint16_t getChannels() const;
+};
+
+/***
+ * plays keyframe clips on pwm registry channels, stepped by actuator tick.
+ * Playing clips are blended by weight, weight ramps on start and stop.
+ * Current output is base layer: clip fading in starts from where servo is.
+ */
+class CAnimator {
+public:
+  struct playing_t {
+    std::string name;
+    float time;
+    float duration;
+    float weight;
+    bool loop;
+  };
+private:
+  struct playback_t {
+    std::string name;
+    std::shared_ptr<const CAnimClip> clip;
+    float time;
+    float speed;
+    float weight;
+    float fade_rate; //weight per second, negative - stopping
+    bool loop;
+    std::vector<uint32_t> cursor; //per track, key at or before time
+  };
+  CPwmRegistry &dev_;
+  std::string folder_;
+  mutable std::mutex mu_;
+  std::vector<std::pair<std::string, std::shared_ptr<const CAnimClip>>> clips_;
+  std::vector<playback_t> playing_;
+  //per channel, under mu_: add() grows them
+  std::vector<float> acc_value_;
+  std::vector<float> acc_weight_;
+  std::vector<float> out_;
+  std::vector<uint8_t> known_; //out_ holds written value
+  std::vector<uint16_t> changed_;
+  void resize(uint16_t channels);
+  void sample(playback_t &playback);
+  size_t advance(float dt); //under mu_
+public:
+  CAnimator(CPwmRegistry &dev) :
+      dev_(dev) {
+  }
+  void add(const std::string &name, const CAnimClip &clip);
+  //all *.anim files of folder, name is file name without extension
+  size_t load(const std::string &folder);
+  size_t reload() {
+    return ("" == folder_) ? 0 : load(folder_);
+  }
+  std::vector<std::string> getClips() const;
+  //restarts clip if playing
+  bool play(const std::string &name, bool loop, uint32_t fade_ms, float speed = 1);
+  //"" - all
+  void stop(const std::string &name, uint32_t fade_ms);
+  std::vector<playing_t> getPlaying() const;
+  //evaluation only, returns number of channels to write
+  size_t evaluate(float dt);
+  void step(float dt);
+  friend void animation_bench();
+};
+
+extern CAnimator animator;
+
+void animation_bench();
+#endif /* CANIMATOR_H_ */
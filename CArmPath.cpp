@@ -0,0 +1,101 @@
+/*
+ * CArmPath.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CArmPath.h"
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+bool CArmPath::set(const vector<waypoint_t> &points, uint32_t blend_ms) {
+  if (points.empty() || (0 != points.front().t_ms)) {
+    return false;
+  }
+  for (size_t idx = 1; idx < points.size(); idx++) {
+    if (points[idx].t_ms <= points[idx - 1].t_ms) {
+      return false;
+    }
+  }
+  points_ = points;
+  blend_.assign(points_.size(), 0);
+  for (size_t idx = 1; idx + 1 < points_.size(); idx++) {
+    const auto shorter = min(time(idx) - time(idx - 1), time(idx + 1) - time(idx));
+    blend_[idx] = min(blend_ms / 1000.f, shorter / 2);
+  }
+  return true;
+}
+
+void CArmPath::velocity(size_t seg, float v[3]) const {
+  const auto &a = points_[seg];
+  const auto &b = points_[seg + 1];
+  const auto inv_dt = 1 / (time(seg + 1) - time(seg));
+  v[0] = (b.x - a.x) * inv_dt;
+  v[1] = (b.y - a.y) * inv_dt;
+  v[2] = (b.z - a.z) * inv_dt;
+}
+
+void CArmPath::linear(size_t seg, float t, float p[3]) const {
+  float v[3];
+  velocity(seg, v);
+  const auto &a = points_[seg];
+  const auto dt = t - time(seg);
+  p[0] = a.x + v[0] * dt;
+  p[1] = a.y + v[1] * dt;
+  p[2] = a.z + v[2] * dt;
+}
+
+size_t CArmPath::segment(float t) const {
+  if (2 > points_.size()) {
+    return 0;
+  }
+  const auto it = upper_bound(points_.begin(), points_.end(), static_cast<uint32_t>(max(0.f, t) * 1000),
+      [](uint32_t t_ms, const waypoint_t &point) {
+        return t_ms < point.t_ms;
+      });
+  const auto idx = static_cast<size_t>(it - points_.begin());
+  return min(idx ? idx - 1 : 0, points_.size() - 2);
+}
+
+void CArmPath::sample(float t, float &x, float &y, float &z) const {
+  float p[3];
+  if (points_.empty()) {
+    x = y = z = 0;
+    return;
+  }
+  if ((2 > points_.size()) || (t >= getDuration())) {
+    x = points_.back().x;
+    y = points_.back().y;
+    z = points_.back().z;
+    return;
+  }
+  t = max(0.f, t);
+  auto seg = segment(t);
+  //blend belongs to waypoint closest to t
+  auto corner = seg;
+  if (t - time(seg) > time(seg + 1) - t) {
+    corner = seg + 1;
+  }
+  const auto tb = blend_[corner];
+  if ((0 < corner) && (corner + 1 < points_.size()) && (tb > 0) && (tb > fabsf(t - time(corner)))) {
+    float v_in[3];
+    float v_out[3];
+    velocity(corner - 1, v_in);
+    velocity(corner, v_out);
+    const auto t0 = time(corner) - tb;
+    linear(corner - 1, t0, p);
+    const auto s = t - t0;
+    const auto k = s * s / (4 * tb);
+    x = p[0] + v_in[0] * s + (v_out[0] - v_in[0]) * k;
+    y = p[1] + v_in[1] * s + (v_out[1] - v_in[1]) * k;
+    z = p[2] + v_in[2] * s + (v_out[2] - v_in[2]) * k;
+    return;
+  }
+  linear(seg, t, p);
+  x = p[0];
+  y = p[1];
+  z = p[2];
+}
@@ -0,0 +1,51 @@
+/*
+ * CArmPath.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CARMPATH_H_
+#define CARMPATH_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+struct waypoint_t {
+  float x; //mm, forward
+  float y; //mm, left
+  float z; //mm, up
+  uint32_t t_ms; //from path start
+};
+
+/***
+ * piecewise linear cartesian path, corners at interior waypoints are blended
+ * with parabola: velocity changes linearly from incoming to outgoing segment
+ * during blend time centered at waypoint
+ */
+class CArmPath {
+  std::vector<waypoint_t> points_;
+  std::vector<float> blend_; //half width, s
+  float time(size_t idx) const {
+    return points_[idx].t_ms / 1000.f;
+  }
+  void linear(size_t seg, float t, float p[3]) const;
+  void velocity(size_t seg, float v[3]) const;
+public:
+  //times strictly increasing, first at 0; blend is limited to half of shorter neighbour segment
+  bool set(const std::vector<waypoint_t> &points, uint32_t blend_ms);
+  float getDuration() const {
+    return points_.empty() ? 0 : time(points_.size() - 1);
+  }
+  size_t getCount() const {
+    return points_.size();
+  }
+  const waypoint_t& getPoint(size_t idx) const {
+    return points_[idx];
+  }
+  //segment index at t
+  size_t segment(float t) const;
+  void sample(float t, float &x, float &y, float &z) const;
+};
+
+#endif /* CARMPATH_H_ */
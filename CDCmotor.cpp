@@ -6,11 +6,10 @@
  */
 
 #include "CDCmotor.h"
+#include "CFlightRecorder.h"
+#include "CPwmRegistry.h"
 #include <stdlib.h>
-#ifndef _SIMULATION_
-#include <wiringPi.h>
-#include "pca9685.h"
-#endif
+#include <math.h>
 #include <iostream>
 #include <string>
 
@@ -20,8 +19,12 @@ void CDCmotor::init() {
 }
 void CDCmotor::set(int16_t power) {
   cout << __FILE__ << ":" << __LINE__ << "  DC[" << pin0_ << ":" << pin1_ << "]=" << power << endl;
+  flight_recorder.value(rec_motor, pin0_, power);
+  write(power);
+}
 
-  auto pwm_power0 = abs(power) * maxPWM / 100;
+void CDCmotor::write(float power) {
+  auto pwm_power0 = static_cast<int32_t>(fabsf(power) * maxPWM / 100);
   auto pwm_power1 = decltype(pwm_power0) { 0 };
   if (maxPWM < pwm_power0) {
     pwm_power0 = maxPWM;
@@ -33,10 +36,7 @@ void CDCmotor::set(int16_t power) {
     pwm_power1 = pwm_power0;
     pwm_power0 = 0;
   }
-
-#ifndef _SIMULATION_
-  pwmWrite(300 + pin0_, pwm_power0);
-  pwmWrite(300 + pin1_, pwm_power1);
-#endif
-
+  CPwmRegistry::Batch batch(pwm_registry);
+  pwm_registry.set(pin0_, pwm_power0);
+  pwm_registry.set(pin1_, pwm_power1);
 }
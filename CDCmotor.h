@@ -19,8 +19,13 @@ public:
       pin0_(_pin0), pin1_(_pin1) {
   }
   ;
+  int getPin() const {
+    return pin0_;
+  }
   void init();
   void set(int16_t power);
+  //power -100..100 without log and record, for control loop
+  void write(float power);
 };
 
 #endif /* CDCMOTOR_H_ */
@@ -0,0 +1,92 @@
+/*
+ * CDiffDrive.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CDiffDrive.h"
+#include "CFlightRecorder.h"
+#include "CPwmRegistry.h"
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+void CDiffDrive::drive(float linear, float angular) {
+  auto left = linear - angular * cfg_.wheel_base / 2;
+  auto right = linear + angular * cfg_.wheel_base / 2;
+  //keep curvature when over limit
+  const auto over = max(fabsf(left), fabsf(right)) / cfg_.max_speed;
+  if (1 < over) {
+    left /= over;
+    right /= over;
+  }
+  CPwmRegistry::Batch batch(pwm_registry); //both wheels in one block write
+  motors_.set(left_, left * 100 / cfg_.max_speed);
+  motors_.set(right_, right * 100 / cfg_.max_speed);
+}
+
+void CDiffDrive::step(float dt) {
+  float left;
+  float right;
+  if (has_encoders()) {
+    const auto count_l = motors_.getCount(left_);
+    const auto count_r = motors_.getCount(right_);
+    left = (count_l - count_l_) / cfg_.counts_per_mm / dt;
+    right = (count_r - count_r_) / cfg_.counts_per_mm / dt;
+    count_l_ = count_l;
+    count_r_ = count_r;
+  } else { //estimate, voltage on motor over nominal
+    const auto scale = motors_.getVoltageScale() * cfg_.max_speed / 100;
+    left = motors_.getOutput(left_) * scale;
+    right = motors_.getOutput(right_) * scale;
+  }
+  pose_t pose;
+  {
+    lock_guard<mutex> guard(pose_mu_);
+    if (reset_) {
+      pose_ = pose_t { };
+      reset_ = false;
+    }
+    pose_.v = (left + right) / 2;
+    pose_.w = (right - left) / cfg_.wheel_base;
+    //midpoint heading for arc
+    const auto theta_mid = pose_.theta + pose_.w * dt / 2;
+    pose_.x += pose_.v * cosf(theta_mid) * dt;
+    pose_.y += pose_.v * sinf(theta_mid) * dt;
+    pose_.theta = remainderf(pose_.theta + pose_.w * dt, 2 * M_PI);
+    pose_.time_us = CFlightRecorder::now_us();
+    pose = pose_;
+  }
+  flight_recorder.pose( { static_cast<int32_t>(lrintf(pose.x)), static_cast<int32_t>(lrintf(pose.y)),
+      static_cast<int32_t>(lrintf(pose.theta * 1000)), static_cast<int32_t>(lrintf(pose.v)),
+      static_cast<int32_t>(lrintf(pose.w * 1000)) });
+  lock_guard<mutex> guard(subscribers_mu_);
+  for (const auto &subscriber : subscribers_) {
+    subscriber.second(pose);
+  }
+}
+
+pose_t CDiffDrive::getPose() const {
+  lock_guard<mutex> guard(pose_mu_);
+  return pose_;
+}
+
+void CDiffDrive::resetPose() {
+  lock_guard<mutex> guard(pose_mu_);
+  reset_ = true; //encoder counts are taken by tick
+}
+
+uint32_t CDiffDrive::subscribe(const pose_handler_t &handler) {
+  lock_guard<mutex> guard(subscribers_mu_);
+  subscribers_.emplace_back(++subscriber_id_, handler);
+  return subscriber_id_;
+}
+
+void CDiffDrive::unsubscribe(uint32_t id) {
+  lock_guard<mutex> guard(subscribers_mu_);
+  subscribers_.erase(remove_if(subscribers_.begin(), subscribers_.end(), [id](const pair<uint32_t, pose_handler_t> &s) {
+    return s.first == id;
+  }), subscribers_.end());
+}
@@ -0,0 +1,74 @@
+/*
+ * CDiffDrive.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CDIFFDRIVE_H_
+#define CDIFFDRIVE_H_
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include "CMotorController.h"
+
+struct pose_t {
+  float x; //mm, start point, x forward
+  float y; //mm, left
+  float theta; //rad, counterclockwise
+  float v; //mm/s
+  float w; //rad/s
+  uint64_t time_us;
+};
+
+struct diff_drive_cfg_t {
+  float wheel_base; //mm, between wheels
+  float max_speed; //mm/s at 100%
+  float counts_per_mm; //encoder, 0 - no encoders
+};
+
+/***
+ * differential drive: linear/angular velocity to wheel targets,
+ * dead reckoning odometry at control rate from encoders or, without them, from wheel outputs.
+ * Pose is published to subscribers from tick thread, handlers must be short
+ */
+class CDiffDrive {
+public:
+  using pose_handler_t = std::function<void(const pose_t&)>;
+private:
+  CMotorController &motors_;
+  const size_t left_;
+  const size_t right_;
+  diff_drive_cfg_t cfg_;
+  int32_t count_l_ = 0;
+  int32_t count_r_ = 0;
+  pose_t pose_ { };
+  mutable std::mutex pose_mu_;
+  bool reset_ = false;
+  std::mutex subscribers_mu_;
+  std::vector<std::pair<uint32_t, pose_handler_t>> subscribers_;
+  uint32_t subscriber_id_ = 0;
+  bool has_encoders() const {
+    return (0 < cfg_.counts_per_mm) && (0 <= motors_.getCount(left_)) && (0 <= motors_.getCount(right_));
+  }
+public:
+  CDiffDrive(CMotorController &motors, size_t left, size_t right, const diff_drive_cfg_t &cfg) :
+      motors_(motors), left_(left), right_(right), cfg_(cfg) {
+  }
+  void setCfg(const diff_drive_cfg_t &cfg) {
+    cfg_ = cfg;
+  }
+  //linear mm/s, angular rad/s; scaled down together when a wheel is over max speed
+  void drive(float linear, float angular);
+  //odometry step, after motor step
+  void step(float dt);
+  pose_t getPose() const;
+  void resetPose();
+  uint32_t subscribe(const pose_handler_t &handler);
+  void unsubscribe(uint32_t id);
+};
+
+extern CDiffDrive diff_drive;
+
+#endif /* CDIFFDRIVE_H_ */
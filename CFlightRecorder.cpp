@@ -0,0 +1,307 @@
+/*
+ * CFlightRecorder.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CFlightRecorder.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+CFlightRecorder flight_recorder;
+
+static constexpr char recorder_magic[8] = "RCBREC1";
+static constexpr uint32_t recorder_version = 2;
+static constexpr size_t page_size = 4096;
+
+size_t CFlightRecorder::data_offset(uint32_t segment_count) {
+  const auto sz = sizeof(file_header_t) + segment_count * sizeof(segment_index_t);
+  return (sz + page_size - 1) / page_size * page_size;
+}
+
+uint64_t CFlightRecorder::now_us() {
+  return chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool CFlightRecorder::open(const string &file, uint32_t seconds, uint32_t records_per_second) {
+  close();
+  auto segment_count = (static_cast<uint64_t>(seconds) * records_per_second + segment_records - 1) / segment_records;
+  if (2 > segment_count) {
+    segment_count = 2;
+  }
+  const auto offset = data_offset(segment_count);
+  size_ = offset + segment_count * segment_records * sizeof(record_t);
+  fd_ = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+  if (-1 == fd_) {
+    perror("recorder open");
+    return false;
+  }
+  struct stat st;
+  const auto resume = (0 == fstat(fd_, &st)) && (static_cast<size_t>(st.st_size) == size_);
+  if (!resume && (0 != ftruncate(fd_, size_))) {
+    perror("recorder truncate");
+    close();
+    return false;
+  }
+  auto mem = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (MAP_FAILED == mem) {
+    perror("recorder mmap");
+    close();
+    return false;
+  }
+  base_ = static_cast<uint8_t*>(mem);
+  header_ = reinterpret_cast<file_header_t*>(base_);
+  index_ = reinterpret_cast<segment_index_t*>(base_ + sizeof(file_header_t));
+  records_ = reinterpret_cast<record_t*>(base_ + offset);
+  capacity_ = segment_count * segment_records;
+  if (!resume || memcmp(header_->magic, recorder_magic, sizeof(recorder_magic)) || (recorder_version != header_->version)
+      || (sizeof(record_t) != header_->record_size) || (segment_records != header_->segment_records)
+      || (segment_count != header_->segment_count)) {
+    memset(base_, 0, offset);
+    memcpy(header_->magic, recorder_magic, sizeof(recorder_magic));
+    header_->version = recorder_version;
+    header_->record_size = sizeof(record_t);
+    header_->segment_records = segment_records;
+    header_->segment_count = segment_count;
+    header_->head = 0;
+    header_->tick_hz = 0;
+    msync(base_, offset, MS_SYNC);
+  }
+  cout << "recorder " << file << " records=" << capacity_ << " window=" << capacity_ / max(records_per_second, 1u)
+      << "s at " << records_per_second << " records/s head=" << header_->head << endl;
+  return true;
+}
+
+void CFlightRecorder::close() {
+  if (base_) {
+    msync(base_, size_, MS_SYNC);
+    munmap(base_, size_);
+    base_ = nullptr;
+  }
+  if (-1 != fd_) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+uint64_t CFlightRecorder::getCount() const {
+  if (!isOpen()) {
+    return 0;
+  }
+  return __atomic_load_n(&header_->head, __ATOMIC_RELAXED);
+}
+
+void CFlightRecorder::setTickRate(uint32_t rate_hz) {
+  if (isOpen()) {
+    header_->tick_hz = rate_hz;
+  }
+}
+
+void CFlightRecorder::roll_segment(uint64_t pos, uint64_t time_us) {
+  const auto segment = (pos / segment_records) % header_->segment_count;
+  auto &index = index_[segment];
+  __atomic_store_n(&index.first_seq, 0, __ATOMIC_RELAXED);
+  index.first_time_us = time_us;
+  index.last_time_us = time_us;
+  __atomic_store_n(&index.first_seq, pos + 1, __ATOMIC_RELEASE);
+  if (pos) { //push finished segment to disk in background
+    const auto prev = ((pos / segment_records) + header_->segment_count - 1) % header_->segment_count;
+    msync(&records_[prev * segment_records], segment_records * sizeof(record_t), MS_ASYNC);
+  }
+}
+
+void CFlightRecorder::append(uint16_t type, uint16_t channel, const void *data, size_t size) {
+  if (!isOpen() && !tap_) {
+    return;
+  }
+  record_t rec;
+  rec.seq = 0;
+  rec.time_us = now_us();
+  rec.type = type;
+  rec.channel = channel;
+  memset(rec.text, 0, sizeof(rec.text));
+  memcpy(rec.text, data, min(size, sizeof(rec.text)));
+  if (tap_) {
+    tap_(rec);
+  }
+  if (!isOpen()) {
+    return;
+  }
+  const auto time_us = rec.time_us;
+  const auto pos = __atomic_fetch_add(&header_->head, 1, __ATOMIC_RELAXED);
+  if (0 == pos % segment_records) {
+    roll_segment(pos, time_us);
+  }
+  auto dst = slot(pos);
+  __atomic_store_n(&dst->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(reinterpret_cast<uint8_t*>(dst) + sizeof(dst->seq), reinterpret_cast<const uint8_t*>(&rec) + sizeof(rec.seq),
+      sizeof(rec) - sizeof(rec.seq));
+  __atomic_store_n(&dst->seq, pos + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&index_[(pos / segment_records) % header_->segment_count].last_time_us, time_us, __ATOMIC_RELAXED);
+}
+
+void CFlightRecorder::radar(uint16_t sensor, int16_t angle, int32_t distance) {
+  record_t rec;
+  rec.radar.angle = angle;
+  rec.radar.reserved = 0;
+  rec.radar.distance = distance;
+  append(rec_radar, sensor, &rec.radar, sizeof(rec.radar));
+}
+
+void CFlightRecorder::value(uint16_t type, uint16_t channel, int32_t value) {
+  append(type, channel, &value, sizeof(value));
+}
+
+void CFlightRecorder::cmd(const char *uri, size_t uri_len, const char *body, size_t body_len) {
+  if (!isOpen() && !tap_) {
+    return;
+  }
+  char text[cmd_text_max];
+  uri_len = min(uri_len, sizeof(text) - 1);
+  body_len = min(body_len, sizeof(text) - uri_len - 1);
+  memcpy(text, uri, uri_len);
+  text[uri_len] = '\n';
+  memcpy(text + uri_len + 1, body, body_len);
+  const auto len = uri_len + 1 + body_len;
+  constexpr auto part_sz = sizeof(record_t::text);
+  const auto parts = (len + part_sz - 1) / part_sz;
+  for (size_t part = 0; part < parts; part++) {
+    const auto channel = static_cast<uint16_t>(part | ((part + 1 == parts) ? rec_cmd_last : 0));
+    append(rec_cmd, channel, text + part * part_sz, min(part_sz, len - part * part_sz));
+  }
+}
+
+bool CFlightRecorder::read(const string &file, const function<void(const record_t&)> &handler, uint64_t window_us) {
+  const auto fd = ::open(file.c_str(), O_RDONLY);
+  if (-1 == fd) {
+    perror("recorder open");
+    return false;
+  }
+  struct stat st;
+  if ((0 != fstat(fd, &st)) || (static_cast<size_t>(st.st_size) < sizeof(file_header_t))) {
+    ::close(fd);
+    return false;
+  }
+  auto mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (MAP_FAILED == mem) {
+    perror("recorder mmap");
+    return false;
+  }
+  const auto base = static_cast<const uint8_t*>(mem);
+  const auto header = reinterpret_cast<const file_header_t*>(base);
+  const auto offset = data_offset(header->segment_count);
+  const uint64_t capacity = static_cast<uint64_t>(header->segment_count) * header->segment_records;
+  if (memcmp(header->magic, recorder_magic, sizeof(recorder_magic)) || (recorder_version != header->version)
+      || (sizeof(record_t) != header->record_size)
+      || (offset + capacity * sizeof(record_t) > static_cast<size_t>(st.st_size))) {
+    cerr << "not a recorder file " << file << endl;
+    munmap(mem, st.st_size);
+    return false;
+  }
+  const auto index = reinterpret_cast<const segment_index_t*>(base + sizeof(file_header_t));
+  const auto records = reinterpret_cast<const record_t*>(base + offset);
+  const auto head = header->head;
+  const auto first = (head > capacity) ? head - capacity : 0;
+  //window is taken from file time, recording may be old
+  uint64_t since_us = 0;
+  if (window_us) {
+    for (auto pos = head; pos > first; pos--) {
+      const auto &rec = records[(pos - 1) % capacity];
+      if (rec.seq == pos) {
+        since_us = (rec.time_us > window_us) ? rec.time_us - window_us : 0;
+        break;
+      }
+    }
+  }
+  //ring is ordered by seq, only slots written completely are valid
+  for (auto pos = first; pos < head; pos++) {
+    if (since_us && (0 == pos % header->segment_records)
+        && (index[(pos / header->segment_records) % header->segment_count].last_time_us < since_us)) {
+      pos += header->segment_records - 1; //whole segment is older
+      continue;
+    }
+    const auto &rec = records[pos % capacity];
+    if ((rec.seq == pos + 1) && (rec.time_us >= since_us)) {
+      handler(rec);
+    }
+  }
+  munmap(mem, st.st_size);
+  return true;
+}
+
+bool CFlightRecorder::read_header(const string &file, file_header_t &header) {
+  const auto fd = ::open(file.c_str(), O_RDONLY);
+  if (-1 == fd) {
+    perror("recorder open");
+    return false;
+  }
+  const auto res = (static_cast<ssize_t>(sizeof(header)) == pread(fd, &header, sizeof(header), 0));
+  ::close(fd);
+  return res && !memcmp(header.magic, recorder_magic, sizeof(recorder_magic)) && (recorder_version == header.version);
+}
+
+bool CFlightRecorder::export_csv(const string &file, ostream &os, uint64_t window_us) {
+  static const char *const type_names[rec_type_count] = { "none", "radar", "pwm", "motor", "servo", "power", "imu", "cmd", "pose" };
+  os << "seq,time_us,type,channel,values" << endl;
+  return read(file, [&os](const record_t &rec) {
+    os << rec.seq << "," << rec.time_us << "," << ((rec.type < rec_type_count) ? type_names[rec.type] : "unknown") << ","
+        << (rec.channel & ~rec_cmd_last);
+    switch (rec.type) {
+    case rec_radar:
+      os << "," << rec.radar.angle << "," << rec.radar.distance;
+      break;
+    case rec_pwm:
+    case rec_motor:
+    case rec_servo:
+    case rec_power:
+      os << "," << rec.val.value;
+      break;
+    case rec_imu:
+      for (const auto v : rec.imu.accel) {
+        os << "," << v;
+      }
+      for (const auto v : rec.imu.gyro) {
+        os << "," << v;
+      }
+      for (const auto v : rec.imu.mag) {
+        os << "," << v;
+      }
+      for (const auto v : rec.imu.quat) {
+        os << "," << v;
+      }
+      break;
+    case rec_pose:
+      os << "," << rec.pose.x << "," << rec.pose.y << "," << rec.pose.theta << "," << rec.pose.v << "," << rec.pose.w;
+      break;
+    case rec_cmd: {
+      os << ",\"";
+      for (size_t pos = 0; (pos < sizeof(rec.text)) && rec.text[pos]; pos++) {
+        const auto ch = rec.text[pos];
+        if ('"' == ch) {
+          os << "\"\"";
+        } else if ('\n' == ch) {
+          os << "\\n";
+        } else {
+          os << ch;
+        }
+      }
+      os << "\"";
+      break;
+    }
+    default:
+      break;
+    }
+    os << "\n";
+  }, window_us);
+}
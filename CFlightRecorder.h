@@ -0,0 +1,148 @@
+/*
+ * CFlightRecorder.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CFLIGHTRECORDER_H_
+#define CFLIGHTRECORDER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <iostream>
+#include <functional>
+
+enum record_type_t : uint16_t {
+  rec_none = 0,
+  rec_radar, //channel - sensor
+  rec_pwm, //channel - pca pin, pwm output
+  rec_motor, //channel - motor pin0, power command
+  rec_servo, //channel - servo pin, value command
+  rec_power, //channel - adc input, mV
+  rec_imu,
+  rec_cmd, //http command "uri\nbody", split in parts, channel - part | rec_cmd_last
+  rec_pose, //odometry
+  rec_type_count
+};
+constexpr uint16_t rec_cmd_last = 0x8000;
+
+struct record_imu_t {
+  int16_t accel[3];
+  int16_t gyro[3];
+  int16_t mag[3];
+  int16_t reserved;
+  int32_t quat[4]; //q30, w x y z
+};
+
+struct record_pose_t {
+  int32_t x; //mm
+  int32_t y;
+  int32_t theta; //mrad
+  int32_t v; //mm/s
+  int32_t w; //mrad/s
+};
+
+struct record_t {
+  uint64_t seq; //1 based, 0 - slot is being written
+  uint64_t time_us;
+  uint16_t type;
+  uint16_t channel;
+  union {
+    struct {
+      int16_t angle;
+      int16_t reserved;
+      int32_t distance;
+    } radar;
+    struct {
+      int32_t value;
+    } val;
+    record_imu_t imu;
+    record_pose_t pose;
+    char text[44];
+  };
+};
+static_assert(sizeof(record_t) == 64, "record must stay fixed size");
+
+/***
+ * appends fixed size records in memory-mapped ring file, split in segments
+ * file: header, segment index, segments. Page cache keeps records on process crash,
+ * finished segments are msync-ed.
+ * no allocation in append, safe for many producers
+ */
+class CFlightRecorder {
+public:
+  static constexpr uint32_t segment_records = 4096;
+  static constexpr uint32_t base_records_per_second = 200; //radar, commands, servo moves
+  static constexpr uint32_t tick_records = 6; //motor pins and pose each tick
+  static constexpr size_t cmd_text_max = 8 * sizeof(record_t::text);
+  struct file_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t segment_records;
+    uint32_t segment_count;
+    uint64_t head; //next seq - 1
+    uint32_t tick_hz; //actuator tick rate of session, 0 - outputs written on each command
+    uint32_t reserved;
+  };
+  struct segment_index_t {
+    uint64_t first_seq;
+    uint64_t first_time_us;
+    uint64_t last_time_us;
+  };
+private:
+  int fd_ = -1;
+  uint8_t *base_ = nullptr;
+  size_t size_ = 0;
+  file_header_t *header_ = nullptr;
+  segment_index_t *index_ = nullptr;
+  record_t *records_ = nullptr;
+  uint64_t capacity_ = 0;
+  std::function<void(const record_t&)> tap_;
+  record_t* slot(uint64_t pos) const {
+    return &records_[pos % capacity_];
+  }
+  void roll_segment(uint64_t pos, uint64_t time_us);
+  static size_t data_offset(uint32_t segment_count);
+public:
+  ~CFlightRecorder() {
+    close();
+  }
+  //record rate budget used for sizing: every imu sample and tick are recorded
+  static uint32_t records_per_second(uint32_t imu_hz, uint32_t tick_hz) {
+    return base_records_per_second + imu_hz + tick_records * tick_hz;
+  }
+  //ring keeps seconds of records at records_per_second
+  bool open(const std::string &file, uint32_t seconds, uint32_t records_per_second);
+  void close();
+  bool isOpen() const {
+    return nullptr != base_;
+  }
+  uint64_t getCount() const;
+  void setTickRate(uint32_t rate_hz);
+  //every appended record is passed to tap too, set before threads are started
+  void set_tap(const std::function<void(const record_t&)> &tap) {
+    tap_ = tap;
+  }
+  static uint64_t now_us();
+  void append(uint16_t type, uint16_t channel, const void *data, size_t size);
+  void radar(uint16_t sensor, int16_t angle, int32_t distance);
+  void value(uint16_t type, uint16_t channel, int32_t value);
+  void imu(const record_imu_t &imu) {
+    append(rec_imu, 0, &imu, sizeof(imu));
+  }
+  void pose(const record_pose_t &pose) {
+    append(rec_pose, 0, &pose, sizeof(pose));
+  }
+  void cmd(const char *uri, size_t uri_len, const char *body, size_t body_len);
+
+  //reads valid records of file ordered by seq, window_us limits them to that long before newest record
+  static bool read(const std::string &file, const std::function<void(const record_t&)> &handler, uint64_t window_us = 0);
+  static bool read_header(const std::string &file, file_header_t &header);
+  static bool export_csv(const std::string &file, std::ostream &os, uint64_t window_us = 0);
+};
+
+extern CFlightRecorder flight_recorder;
+
+#endif /* CFLIGHTRECORDER_H_ */
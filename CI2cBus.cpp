@@ -0,0 +1,506 @@
+/*
+ * CI2cBus.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CI2cBus.h"
+#include "I2cStats.h"
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <iostream>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <vector>
+#ifndef _SIMULATION_
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#else
+#include "CI2cSim.h"
+#endif
+
+using namespace std;
+
+constexpr size_t CI2cBus::max_write;
+constexpr size_t CI2cBus::max_read;
+
+const char* i2c_class_name(i2c_class_t cls) {
+  switch (cls) {
+    case i2c_motor:
+      return "motor";
+    case i2c_imu:
+      return "imu";
+    case i2c_telemetry:
+      return "telemetry";
+    default:
+      return "unknown";
+  }
+}
+
+static uint64_t monotonic_ns() {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CI2cBus::CI2cBus(uint8_t bus) :
+    bus_(bus) {
+  for (auto &fd : fd_) {
+    fd.store(-1, std::memory_order_relaxed);
+  }
+  for (auto &mask : auto_increment_) {
+    mask.store(0, std::memory_order_relaxed);
+  }
+#ifdef _SIMULATION_
+  for (auto &device : devices_) {
+    device.store(nullptr, std::memory_order_relaxed);
+  }
+#endif
+  sem_init(&work_, 0, 0);
+}
+
+CI2cBus::~CI2cBus() {
+  stop();
+  sem_destroy(&work_);
+#ifndef _SIMULATION_
+  for (auto &fd : fd_) {
+    if (0 <= fd.load(std::memory_order_relaxed)) {
+      ::close(fd.load(std::memory_order_relaxed));
+    }
+  }
+#endif
+}
+
+int CI2cBus::open(uint8_t address) {
+  address &= 0x7f;
+  lock_guard<mutex> lock(open_mu_);
+  auto fd = fd_[address].load(std::memory_order_relaxed);
+  if (0 <= fd) {
+    return fd;
+  }
+#ifndef _SIMULATION_
+  const auto device = "/dev/i2c-" + to_string(bus_);
+  fd = ::open(device.c_str(), O_RDWR);
+  if (0 > fd) {
+    perror(device.c_str());
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  if (0 > ioctl(fd, I2C_SLAVE, address)) {
+    perror("i2c slave");
+    ::close(fd);
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  fd_[address].store(fd, std::memory_order_release);
+#endif
+  return fd;
+}
+
+#ifdef _SIMULATION_
+void CI2cBus::sim_delay(size_t bytes) {
+  const auto ns = latency_ns_ + (bus_delay_ ? i2c_transaction_ns(bytes) : 0);
+  if (ns) {
+    this_thread::sleep_for(chrono::nanoseconds(ns));
+  }
+}
+#endif
+
+int CI2cBus::do_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len) {
+  const auto started_ns = CI2cProfile::now_ns();
+  transfers_.fetch_add(1, std::memory_order_relaxed);
+  auto result = 0;
+#ifndef _SIMULATION_
+  const auto fd = handle(address);
+  if (0 > fd) {
+    result = -1;
+  } else {
+    i2c_msg msgs[2];
+    msgs[0].addr = address;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].addr = address;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = static_cast<uint16_t>(len);
+    msgs[1].buf = data;
+    i2c_rdwr_ioctl_data transfer { msgs, 2 };
+    if (0 > ioctl(fd, I2C_RDWR, &transfer)) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      result = -1;
+    }
+  }
+#else
+  {
+    lock_guard<mutex> wire(sim_mu_);
+    sim_delay(len + 2); //register write, repeated start with address, data
+    const auto device = devices_[address & 0x7f].load(std::memory_order_acquire);
+    if (!device || (0 != device->read(reg, data, len))) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      result = -1;
+    }
+  }
+#endif
+  profile_.account(address, reg, true, len + 1, started_ns, 0 != result);
+  return result;
+}
+
+int CI2cBus::do_write(uint8_t address, const uint8_t *data, size_t len) {
+  const auto started_ns = CI2cProfile::now_ns();
+  transfers_.fetch_add(1, std::memory_order_relaxed);
+  auto result = 0;
+#ifndef _SIMULATION_
+  const auto fd = handle(address);
+  if (0 > fd) {
+    result = -1;
+  } else if (static_cast<ssize_t>(len) != ::write(fd, data, len)) {
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    result = -1;
+  }
+#else
+  {
+    lock_guard<mutex> wire(sim_mu_);
+    sim_delay(len);
+    const auto device = devices_[address & 0x7f].load(std::memory_order_acquire);
+    if (!device || (0 != device->write(data, len))) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+      result = -1;
+    }
+  }
+#endif
+  profile_.account(address, data[0], false, len, started_ns, 0 != result);
+  return result;
+}
+
+int CI2cBus::readReg(uint8_t address, uint8_t reg, uint8_t *data, size_t len, i2c_class_t cls) {
+  if (max_read < len) {
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  op_t op;
+  op.address = address;
+  op.read = true;
+  op.reg = reg;
+  op.wdata = nullptr;
+  op.rdata = data;
+  op.len = len;
+  return transfer(op, cls);
+}
+
+int CI2cBus::writeReg(uint8_t address, uint8_t reg, const uint8_t *data, size_t len, i2c_class_t cls) {
+  if (max_write <= len) {
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  uint8_t buf[max_write];
+  buf[0] = reg;
+  memcpy(&buf[1], data, len);
+  return write(address, buf, len + 1, cls);
+}
+
+int CI2cBus::write(uint8_t address, const uint8_t *data, size_t len, i2c_class_t cls) {
+  if ((0 == len) || (max_write < len)) {
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    return -1;
+  }
+  op_t op;
+  op.address = address;
+  op.read = false;
+  op.reg = data[0];
+  op.wdata = data;
+  op.rdata = nullptr;
+  op.len = len;
+  return transfer(op, cls);
+}
+
+int CI2cBus::transfer(op_t &op, i2c_class_t cls) {
+  const auto started_ns = monotonic_ns();
+  bool queued = false;
+  {
+    lock_guard<mutex> lock(queue_mu_);
+    if (running_) {
+      sem_init(&op.done, 0, 0);
+      op.next = nullptr;
+      if (tail_[cls]) {
+        tail_[cls]->next = &op;
+      } else {
+        head_[cls] = &op;
+      }
+      tail_[cls] = &op;
+      queued = true;
+    }
+  }
+  if (queued) {
+    sem_post(&work_);
+    while (0 != sem_wait(&op.done)) { //EINTR
+    }
+    sem_destroy(&op.done);
+  } else {
+    op.result = execute(op);
+  }
+  const auto latency_ns = static_cast<uint32_t>(monotonic_ns() - started_ns);
+  auto &stats = stats_[cls];
+  stats.ops.fetch_add(1, std::memory_order_relaxed);
+  stats.latency_sum_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+  auto max_ns = stats.latency_max_ns.load(std::memory_order_relaxed);
+  while ((latency_ns > max_ns)
+      && !stats.latency_max_ns.compare_exchange_weak(max_ns, latency_ns, std::memory_order_relaxed)) {
+  }
+  return op.result;
+}
+
+CI2cBus::op_t* CI2cBus::pop_batch(i2c_class_t &cls) {
+  for (uint8_t idx = 0; idx < i2c_classes; idx++) {
+    auto batch = head_[idx];
+    if (!batch) {
+      continue;
+    }
+    cls = static_cast<i2c_class_t>(idx);
+    //following ops continue where batch ends: one block transfer
+    auto last = batch;
+    size_t len = batch->len;
+    if (isAutoIncrement(batch->address)) {
+      for (auto next = batch->next; next; next = next->next) {
+        const auto data_len = next->read ? next->len : next->len - 1;
+        const auto end = batch->read ? batch->reg + len : batch->reg + len - 1;
+        if ((next->address != batch->address) || (next->read != batch->read) || (next->reg != end)
+            || ((batch->read ? max_read : max_write) < len + data_len)) {
+          break;
+        }
+        len += data_len;
+        last = next;
+      }
+    }
+    head_[idx] = last->next;
+    if (!head_[idx]) {
+      tail_[idx] = nullptr;
+    }
+    last->next = nullptr;
+    return batch;
+  }
+  return nullptr;
+}
+
+void CI2cBus::run_batch(op_t *batch, i2c_class_t cls) {
+  int result;
+  if (!batch->next) {
+    result = execute(*batch);
+  } else if (batch->read) {
+    uint8_t buf[max_read];
+    size_t len = 0;
+    for (auto op = batch; op; op = op->next) {
+      len += op->len;
+    }
+    result = do_read(batch->address, batch->reg, buf, len);
+    size_t pos = 0;
+    for (auto op = batch; op; op = op->next) {
+      memcpy(op->rdata, &buf[pos], op->len);
+      pos += op->len;
+    }
+  } else {
+    uint8_t buf[max_write];
+    size_t len = 1;
+    buf[0] = batch->reg;
+    for (auto op = batch; op; op = op->next) {
+      memcpy(&buf[len], &op->wdata[1], op->len - 1);
+      len += op->len - 1;
+    }
+    result = do_write(batch->address, buf, len);
+  }
+  for (auto op = batch; op;) {
+    const auto next = op->next; //op is gone once caller is released
+    if (op != batch) {
+      stats_[cls].merged.fetch_add(1, std::memory_order_relaxed);
+    }
+    op->result = result;
+    sem_post(&op->done);
+    op = next;
+  }
+}
+
+void CI2cBus::bus_function() {
+  if (priority_) {
+    sched_param param { };
+    param.sched_priority = priority_;
+    const auto err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err) {
+      cerr << "i2c bus SCHED_FIFO " << priority_ << " failed err=" << err << endl;
+    }
+  }
+  for (;;) {
+    sem_wait(&work_);
+    //one wake up serves all queued transactions, highest class is taken again after each transfer
+    for (;;) {
+      i2c_class_t cls;
+      op_t *batch;
+      {
+        lock_guard<mutex> lock(queue_mu_);
+        batch = pop_batch(cls);
+        if (!batch && !running_) {
+          return;
+        }
+      }
+      if (!batch) {
+        break;
+      }
+      run_batch(batch, cls);
+    }
+  }
+}
+
+bool CI2cBus::start(int priority) {
+  lock_guard<mutex> lock(queue_mu_);
+  if (running_) {
+    return false;
+  }
+  priority_ = priority;
+  running_ = true;
+  thd_ = std::thread(&CI2cBus::bus_function, this);
+  return true;
+}
+
+void CI2cBus::stop() {
+  {
+    lock_guard<mutex> lock(queue_mu_);
+    if (!running_) {
+      return;
+    }
+    running_ = false; //queued ones are still served
+  }
+  sem_post(&work_);
+  if (thd_.joinable()) {
+    thd_.join();
+  }
+}
+
+bool CI2cBus::isRunning() const {
+  lock_guard<mutex> lock(queue_mu_);
+  return running_;
+}
+
+uint32_t CI2cBus::getLatencyAvgNs(i2c_class_t cls) const {
+  const auto ops = getOps(cls);
+  return ops ? stats_[cls].latency_sum_ns.load(std::memory_order_relaxed) / ops : 0;
+}
+
+void CI2cBus::resetStats() {
+  for (auto &stats : stats_) {
+    stats.ops.store(0, std::memory_order_relaxed);
+    stats.merged.store(0, std::memory_order_relaxed);
+    stats.latency_sum_ns.store(0, std::memory_order_relaxed);
+    stats.latency_max_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+//function statics: pwm boards take their bus in global constructors
+static mutex& buses_mu() {
+  static mutex mu;
+  return mu;
+}
+
+static unique_ptr<CI2cBus>* buses() {
+  static unique_ptr<CI2cBus> table[CI2cBus::max_buses];
+  return table;
+}
+
+CI2cBus& i2c_bus(uint8_t bus) {
+  bus %= CI2cBus::max_buses;
+  lock_guard<mutex> lock(buses_mu());
+  auto &found = buses()[bus];
+  if (!found) {
+    found.reset(new CI2cBus(bus));
+  }
+  return *found;
+}
+
+void i2c_buses(const function<void(CI2cBus&)> &visit) {
+  for (uint8_t bus = 0; bus < CI2cBus::max_buses; bus++) {
+    CI2cBus *found;
+    {
+      lock_guard<mutex> lock(buses_mu());
+      found = buses()[bus].get();
+    }
+    if (found) {
+      visit(*found);
+    }
+  }
+}
+
+void i2c_sched_bench() {
+#ifndef _SIMULATION_
+  cout << "i2c bench runs on simulated bus, build with SIMULATION=1" << endl;
+  return;
+#else
+  //bus shared as on robot: two pwm producers on adjacent LEDn registers, imu fifo drain every 10ms,
+  //two adc readers converting back to back. Simulated wire is held for transaction time.
+  constexpr uint8_t pca9685_address = 0x40;
+  constexpr uint8_t mpu_address = 0x68;
+  constexpr uint8_t ads1115_address = 0x48;
+  for (const auto scheduled : { false, true }) {
+    CSimPca9685 pca9685;
+    CSimMpu9250 mpu;
+    CSimAds1115 ads1115;
+    CI2cBus bus(0);
+    bus.attach(pca9685_address, &pca9685);
+    bus.attach(mpu_address, &mpu);
+    bus.attach(ads1115_address, &ads1115);
+    bus.setBusDelay(true);
+    bus.setAutoIncrement(pca9685_address);
+    if (scheduled) {
+      bus.start();
+    }
+    atomic<bool> execute { true };
+    vector<thread> threads;
+    for (uint8_t first : { 0, 2 }) { //wheels, arm
+      threads.emplace_back([&bus, &execute, first]() {
+        uint8_t buf[1 + 2 * 4] = { static_cast<uint8_t>(0x06 + 4 * first) };
+        auto next = chrono::steady_clock::now();
+        while (execute.load(std::memory_order_relaxed)) {
+          bus.write(pca9685_address, buf, sizeof(buf), i2c_motor);
+          next += chrono::milliseconds(5);
+          this_thread::sleep_until(next);
+        }
+      });
+    }
+    threads.emplace_back([&bus, &execute]() {
+      uint8_t buf[120];
+      auto next = chrono::steady_clock::now();
+      while (execute.load(std::memory_order_relaxed)) {
+        bus.readReg(mpu_address, 0x72, buf, 2, i2c_imu);
+        bus.readReg(mpu_address, 0x74, buf, sizeof(buf), i2c_imu);
+        next += chrono::milliseconds(10);
+        this_thread::sleep_until(next);
+      }
+    });
+    for (auto idx = 0; idx < 2; idx++) {
+      threads.emplace_back([&bus, &execute]() {
+        uint8_t buf[2] = { 0xc3, 0xe3 };
+        while (execute.load(std::memory_order_relaxed)) {
+          bus.writeReg(ads1115_address, 1, buf, sizeof(buf), i2c_telemetry);
+          this_thread::sleep_for(chrono::microseconds(1200)); //860 SPS conversion
+          bus.readReg(ads1115_address, 1, buf, sizeof(buf), i2c_telemetry);
+          bus.readReg(ads1115_address, 0, buf, sizeof(buf), i2c_telemetry);
+        }
+      });
+    }
+    this_thread::sleep_for(chrono::seconds(3));
+    execute = false;
+    for (auto &thd : threads) {
+      thd.join();
+    }
+    bus.stop();
+    cout << "i2c " << (scheduled ? "scheduled" : "direct   ") << " transfers=" << bus.getTransfers() << endl;
+    for (uint8_t idx = 0; idx < i2c_classes; idx++) {
+      const auto cls = static_cast<i2c_class_t>(idx);
+      cout << "  " << i2c_class_name(cls) << " ops=" << bus.getOps(cls) << " merged=" << bus.getMerged(cls)
+          << " latency avg=" << bus.getLatencyAvgNs(cls) / 1000 << "us max=" << bus.getLatencyMaxNs(cls) / 1000 << "us"
+          << endl;
+    }
+  }
+#endif
+}
@@ -0,0 +1,193 @@
+/*
+ * CI2cBus.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CI2CBUS_H_
+#define CI2CBUS_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <semaphore.h>
+#include "CI2cProfile.h"
+
+//transaction priority, lower goes first
+enum i2c_class_t : uint8_t {
+  i2c_motor, //motor and safety writes
+  i2c_imu, //imu fifo drains
+  i2c_telemetry, //adc and other slow reads
+  i2c_classes
+};
+
+const char* i2c_class_name(i2c_class_t cls);
+
+#ifdef _SIMULATION_
+/***
+ * register level model of device on simulated bus.
+ * Transfers of one bus reach models one at a time.
+ * Methods return 0 - acked, -1 - not acked.
+ */
+class CI2cDevice {
+public:
+  virtual ~CI2cDevice() {
+  }
+  //register write, repeated start, read
+  virtual int read(uint8_t reg, uint8_t *data, size_t len) = 0;
+  //write transfer, first byte is usually register
+  virtual int write(const uint8_t *data, size_t len) = 0;
+};
+#endif
+
+/***
+ * /dev/i2c-N transport shared by all devices of bus.
+ * Handle per device address is opened on first use and kept, so devices
+ * behind one another (AK8963 behind MPU-9250) get own handle.
+ * Register read is one I2C_RDWR ioctl: register write, repeated start, read.
+ *
+ * Started bus is owned by manager thread: callers queue transaction by class and wait,
+ * thread always takes the highest class first, so motor write waits at most for
+ * the transfer on wire, never for queued imu or adc ones. Queued transactions of one class
+ * to adjacent registers of auto-increment device are sent as one transfer.
+ * Not started bus is accessed directly by caller.
+ * Every transfer on wire is profiled.
+ * Simulated bus passes transfers to attached device models, other addresses are not acked.
+ * Methods return 0 on success, -1 on error.
+ */
+class CI2cBus {
+public:
+  static constexpr uint8_t max_buses = 32;
+  static constexpr size_t max_write = 128; //register + data of one write transfer
+  static constexpr size_t max_read = 256;
+private:
+  static constexpr uint8_t addresses = 128;
+  struct op_t {
+    op_t *next;
+    uint8_t address;
+    bool read;
+    uint8_t reg;
+    const uint8_t *wdata; //write: register and data
+    uint8_t *rdata;
+    size_t len; //read: data, write: register and data
+    int result;
+    sem_t done;
+  };
+  struct class_stats_t {
+    std::atomic<uint32_t> ops { 0 };
+    std::atomic<uint32_t> merged { 0 }; //sent within transfer of previous op
+    std::atomic<uint64_t> latency_sum_ns { 0 }; //queued and on wire
+    std::atomic<uint32_t> latency_max_ns { 0 };
+  };
+  const uint8_t bus_;
+  std::atomic<int> fd_[addresses];
+  std::atomic<uint32_t> auto_increment_[addresses / 32];
+  std::mutex open_mu_;
+#ifdef _SIMULATION_
+  std::atomic<CI2cDevice*> devices_[addresses];
+  bool bus_delay_ = false;
+  uint32_t latency_ns_ = 0;
+  std::mutex sim_mu_; //wire, held for transfer time
+  void sim_delay(size_t bytes);
+#endif
+
+  mutable std::mutex queue_mu_;
+  op_t *head_[i2c_classes] = { };
+  op_t *tail_[i2c_classes] = { };
+  bool running_ = false; //under queue_mu_, no op is queued after it is cleared
+  sem_t work_;
+  int priority_ = 0;
+  std::thread thd_;
+
+  std::atomic<uint32_t> transfers_ { 0 }; //syscalls
+  std::atomic<uint32_t> errors_ { 0 };
+  class_stats_t stats_[i2c_classes];
+  CI2cProfile profile_;
+  int open(uint8_t address);
+  int do_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len);
+  int do_write(uint8_t address, const uint8_t *data, size_t len);
+  int execute(const op_t &op) {
+    return op.read ? do_read(op.address, op.reg, op.rdata, op.len) : do_write(op.address, op.wdata, op.len);
+  }
+  int transfer(op_t &op, i2c_class_t cls);
+  op_t* pop_batch(i2c_class_t &cls);
+  void run_batch(op_t *batch, i2c_class_t cls);
+  void bus_function();
+public:
+  CI2cBus(uint8_t bus);
+  ~CI2cBus();
+  uint8_t getBus() const {
+    return bus_;
+  }
+  //priority: manager thread SCHED_FIFO priority, 0 - normal scheduling
+  bool start(int priority = 0);
+  void stop();
+  bool isRunning() const;
+#ifdef _SIMULATION_
+  //device model answering at address, nullptr - detached
+  void attach(uint8_t address, CI2cDevice *device) {
+    devices_[address & 0x7f].store(device, std::memory_order_release);
+  }
+  //transfer holds wire for bus transaction time
+  void setBusDelay(bool delay) {
+    bus_delay_ = delay;
+  }
+  //fixed cost of each transfer: driver, controller, clock stretching
+  void setLatency(uint32_t ns) {
+    latency_ns_ = ns;
+  }
+#endif
+  //device register pointer increments over block access, adjacent transfers can be merged
+  void setAutoIncrement(uint8_t address) {
+    address &= 0x7f;
+    auto_increment_[address / 32].fetch_or(1u << (address % 32), std::memory_order_relaxed);
+  }
+  bool isAutoIncrement(uint8_t address) const {
+    address &= 0x7f;
+    return auto_increment_[address / 32].load(std::memory_order_relaxed) & (1u << (address % 32));
+  }
+  //cached handle bound to address, for libraries taking fd (wiringPi pca9685)
+  int handle(uint8_t address) {
+    const auto fd = fd_[address & 0x7f].load(std::memory_order_acquire);
+    return (0 <= fd) ? fd : open(address);
+  }
+  int readReg(uint8_t address, uint8_t reg, uint8_t *data, size_t len, i2c_class_t cls = i2c_telemetry);
+  int writeReg(uint8_t address, uint8_t reg, const uint8_t *data, size_t len, i2c_class_t cls = i2c_telemetry);
+  //raw write, first byte is usually register
+  int write(uint8_t address, const uint8_t *data, size_t len, i2c_class_t cls = i2c_telemetry);
+  uint32_t getTransfers() const {
+    return transfers_.load(std::memory_order_relaxed);
+  }
+  uint32_t getErrors() const {
+    return errors_.load(std::memory_order_relaxed);
+  }
+  uint32_t getOps(i2c_class_t cls) const {
+    return stats_[cls].ops.load(std::memory_order_relaxed);
+  }
+  uint32_t getMerged(i2c_class_t cls) const {
+    return stats_[cls].merged.load(std::memory_order_relaxed);
+  }
+  uint32_t getLatencyAvgNs(i2c_class_t cls) const;
+  uint32_t getLatencyMaxNs(i2c_class_t cls) const {
+    return stats_[cls].latency_max_ns.load(std::memory_order_relaxed);
+  }
+  void resetStats();
+  //every transfer on wire
+  const CI2cProfile& getProfile() const {
+    return profile_;
+  }
+  CI2cProfile& getProfile() {
+    return profile_;
+  }
+};
+
+//bus by number below max_buses, created on first use
+CI2cBus& i2c_bus(uint8_t bus);
+//buses created so far
+void i2c_buses(const std::function<void(CI2cBus&)> &visit);
+
+void i2c_sched_bench();
+#endif /* CI2CBUS_H_ */
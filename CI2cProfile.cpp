@@ -0,0 +1,249 @@
+/*
+ * CI2cProfile.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CI2cProfile.h"
+#include "CI2cBus.h"
+#include "I2cStats.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#ifdef _SIMULATION_
+#include "CI2cSim.h"
+#endif
+
+using namespace std;
+
+constexpr size_t i2c_counters_t::buckets;
+constexpr uint8_t CI2cProfile::addresses;
+constexpr size_t CI2cProfile::register_slots;
+constexpr uint32_t CI2cProfile::slot_ms;
+constexpr size_t CI2cProfile::window_slots;
+
+void i2c_counters_t::account(bool read, size_t _bytes, uint32_t latency_ns, bool error) {
+  (read ? reads : writes).fetch_add(1, std::memory_order_relaxed);
+  if (error) {
+    errors.fetch_add(1, std::memory_order_relaxed);
+  }
+  bytes.fetch_add(_bytes, std::memory_order_relaxed);
+  //register read: register write and repeated start with address
+  wire_ns.fetch_add(i2c_transaction_ns(read ? _bytes + 1 : _bytes), std::memory_order_relaxed);
+  latency_sum_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+  auto max_ns = latency_max_ns.load(std::memory_order_relaxed);
+  while ((latency_ns > max_ns) && !latency_max_ns.compare_exchange_weak(max_ns, latency_ns, std::memory_order_relaxed)) {
+  }
+  const auto latency_us = latency_ns / 1000;
+  size_t bucket = 0;
+  while ((bucket + 1 < buckets) && (latency_us >= bucket_us(bucket))) {
+    bucket++;
+  }
+  histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void i2c_counters_t::reset() {
+  reads.store(0, std::memory_order_relaxed);
+  writes.store(0, std::memory_order_relaxed);
+  errors.store(0, std::memory_order_relaxed);
+  bytes.store(0, std::memory_order_relaxed);
+  wire_ns.store(0, std::memory_order_relaxed);
+  latency_sum_ns.store(0, std::memory_order_relaxed);
+  latency_max_ns.store(0, std::memory_order_relaxed);
+  for (auto &bucket : histogram) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t CI2cProfile::now_ns() {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CI2cProfile::CI2cProfile() :
+    started_ns_(now_ns()) {
+  for (auto &key : register_keys_) {
+    key.store(0, std::memory_order_relaxed);
+  }
+}
+
+i2c_counters_t* CI2cProfile::find_register(uint8_t address, uint8_t reg) {
+  const uint16_t key = 1 + (((address & 0x7f) << 8) | reg);
+  //open addressing, slot is claimed once and never freed
+  for (size_t probe = 0; probe < register_slots; probe++) {
+    const auto slot = (key * 40503u + probe) % register_slots;
+    auto found = register_keys_[slot].load(std::memory_order_acquire);
+    if ((0 == found) && register_keys_[slot].compare_exchange_strong(found, key, std::memory_order_acq_rel)) {
+      return &registers_[slot];
+    }
+    if (found == key) {
+      return &registers_[slot];
+    }
+  }
+  return nullptr;
+}
+
+void CI2cProfile::account(uint8_t address, uint8_t reg, bool read, size_t bytes, uint64_t started_ns, bool error) {
+  const auto now = now_ns();
+  const auto latency_ns = static_cast<uint32_t>(now - started_ns);
+  devices_[address & 0x7f].account(read, bytes, latency_ns, error);
+  auto counters = find_register(address, reg);
+  if (counters) {
+    counters->account(read, bytes, latency_ns, error);
+  } else {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+  //slot of other epoch is restarted by first thread that sees it
+  const auto epoch = static_cast<uint32_t>((now - started_ns_) / (slot_ms * 1000000ull)) + 1;
+  auto &slot = window_[epoch % window_slots];
+  auto slot_epoch = slot.epoch.load(std::memory_order_acquire);
+  if ((slot_epoch != epoch) && slot.epoch.compare_exchange_strong(slot_epoch, epoch, std::memory_order_acq_rel)) {
+    slot.busy_ns.store(0, std::memory_order_relaxed);
+    slot.wire_ns.store(0, std::memory_order_relaxed);
+  }
+  slot.busy_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+  slot.wire_ns.fetch_add(i2c_transaction_ns(read ? bytes + 1 : bytes), std::memory_order_relaxed);
+}
+
+void CI2cProfile::devices(const function<void(uint8_t address, const i2c_counters_t&)> &visit) const {
+  for (uint8_t address = 0; address < addresses; address++) {
+    if (devices_[address].getTransfers()) {
+      visit(address, devices_[address]);
+    }
+  }
+}
+
+void CI2cProfile::registers(const function<void(uint8_t address, uint8_t reg, const i2c_counters_t&)> &visit) const {
+  //by device and register
+  vector<pair<uint16_t, size_t>> used;
+  for (size_t slot = 0; slot < register_slots; slot++) {
+    const auto key = register_keys_[slot].load(std::memory_order_acquire);
+    if (key) {
+      used.emplace_back(key, slot);
+    }
+  }
+  sort(used.begin(), used.end());
+  for (const auto &it : used) {
+    visit(static_cast<uint8_t>((it.first - 1) >> 8), static_cast<uint8_t>((it.first - 1) & 0xff), registers_[it.second]);
+  }
+}
+
+static float utilization(uint64_t now, uint64_t started_ns, const uint64_t sums[], const uint32_t epochs[], size_t slots,
+    uint32_t slot_ms) {
+  const auto slot_ns = slot_ms * 1000000ull;
+  const auto epoch = static_cast<uint32_t>((now - started_ns) / slot_ns) + 1;
+  uint64_t busy = 0;
+  for (size_t idx = 0; idx < slots; idx++) {
+    if ((epochs[idx] <= epoch) && (epoch - epochs[idx] < slots)) {
+      busy += sums[idx];
+    }
+  }
+  //full slots before current one and elapsed part of current, not before profile start
+  const auto elapsed_ns = now - started_ns;
+  const auto window_ns = min<uint64_t>(elapsed_ns, (slots - 1) * slot_ns + (elapsed_ns % slot_ns));
+  return window_ns ? min(1.f, static_cast<float>(busy) / window_ns) : 0;
+}
+
+float CI2cProfile::getBusyUtilization() const {
+  uint64_t sums[window_slots];
+  uint32_t epochs[window_slots];
+  for (size_t idx = 0; idx < window_slots; idx++) {
+    epochs[idx] = window_[idx].epoch.load(std::memory_order_acquire);
+    sums[idx] = window_[idx].busy_ns.load(std::memory_order_relaxed);
+  }
+  return utilization(now_ns(), started_ns_, sums, epochs, window_slots, slot_ms);
+}
+
+float CI2cProfile::getWireUtilization() const {
+  uint64_t sums[window_slots];
+  uint32_t epochs[window_slots];
+  for (size_t idx = 0; idx < window_slots; idx++) {
+    epochs[idx] = window_[idx].epoch.load(std::memory_order_acquire);
+    sums[idx] = window_[idx].wire_ns.load(std::memory_order_relaxed);
+  }
+  return utilization(now_ns(), started_ns_, sums, epochs, window_slots, slot_ms);
+}
+
+void CI2cProfile::reset() {
+  for (auto &device : devices_) {
+    device.reset();
+  }
+  //slots keep their registers, counters restart
+  for (auto &counters : registers_) {
+    counters.reset();
+  }
+  dropped_.store(0, std::memory_order_relaxed);
+}
+
+void i2c_profile_bench() {
+  //cost of profiling per transfer and traffic split of typical robot load on simulated wire
+  {
+    CI2cProfile profile;
+    constexpr uint32_t transfers = 1000000;
+    const auto started_ns = CI2cProfile::now_ns();
+    for (uint32_t idx = 0; idx < transfers; idx++) {
+      profile.account(0x40, 0x06 + 4 * (idx % 16), false, 5, CI2cProfile::now_ns(), false);
+    }
+    cout << "i2c profile account " << (CI2cProfile::now_ns() - started_ns) / transfers << "ns per transfer" << endl;
+  }
+#ifndef _SIMULATION_
+  cout << "i2c bench runs on simulated bus, build with SIMULATION=1" << endl;
+#else
+  CSimPca9685 pca9685;
+  CSimMpu9250 mpu;
+  CSimAds1115 ads1115;
+  CI2cBus bus(0);
+  bus.attach(0x40, &pca9685);
+  bus.attach(0x68, &mpu);
+  bus.attach(0x48, &ads1115);
+  bus.setBusDelay(true);
+  bus.start(); //transfers do not overlap, busy time is bus time
+  atomic<bool> execute { true };
+  thread pwm([&bus, &execute]() {
+    uint8_t buf[1 + 4 * 4] = { 0x06 };
+    while (execute.load(std::memory_order_relaxed)) {
+      bus.write(0x40, buf, sizeof(buf), i2c_motor);
+      this_thread::sleep_for(chrono::milliseconds(20)); //50 Hz frame
+    }
+  });
+  thread imu([&bus, &execute]() {
+    uint8_t buf[120];
+    while (execute.load(std::memory_order_relaxed)) {
+      bus.readReg(0x68, 0x72, buf, 2, i2c_imu);
+      bus.readReg(0x68, 0x74, buf, sizeof(buf), i2c_imu); //10 packets of 12 bytes
+      this_thread::sleep_for(chrono::milliseconds(10));
+    }
+  });
+  thread adc([&bus, &execute]() {
+    uint8_t buf[2] = { 0xc3, 0xe3 };
+    while (execute.load(std::memory_order_relaxed)) {
+      bus.writeReg(0x48, 1, buf, sizeof(buf), i2c_telemetry);
+      this_thread::sleep_for(chrono::microseconds(1200));
+      bus.readReg(0x48, 1, buf, sizeof(buf), i2c_telemetry);
+      bus.readReg(0x48, 0, buf, sizeof(buf), i2c_telemetry);
+      this_thread::sleep_for(chrono::milliseconds(100));
+    }
+  });
+  this_thread::sleep_for(chrono::seconds(2));
+  const auto &profile = bus.getProfile();
+  cout << "i2c profile bus busy=" << profile.getBusyUtilization() * 100 << "% wire=" << profile.getWireUtilization() * 100
+      << "%" << endl;
+  execute = false;
+  pwm.join();
+  imu.join();
+  adc.join();
+  bus.stop();
+  profile.devices([](uint8_t address, const i2c_counters_t &counters) {
+    cout << " device 0x" << hex << static_cast<unsigned>(address) << dec << " reads=" << counters.reads << " writes="
+        << counters.writes << " bytes=" << counters.bytes << " latency avg=" << counters.getLatencyAvgNs() / 1000
+        << "us max=" << counters.latency_max_ns / 1000 << "us" << endl;
+  });
+  profile.registers([](uint8_t address, uint8_t reg, const i2c_counters_t &counters) {
+    cout << "  0x" << hex << static_cast<unsigned>(address) << ":0x" << static_cast<unsigned>(reg) << dec
+        << " transfers=" << counters.getTransfers() << " bytes=" << counters.bytes << endl;
+  });
+#endif
+}
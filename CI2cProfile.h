@@ -0,0 +1,91 @@
+/*
+ * CI2cProfile.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CI2CPROFILE_H_
+#define CI2CPROFILE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <functional>
+
+//counters of one device or register, updated by any thread without lock
+struct i2c_counters_t {
+  static constexpr size_t buckets = 11; //latency below 32us << bucket, last one - above
+  std::atomic<uint32_t> reads { 0 };
+  std::atomic<uint32_t> writes { 0 };
+  std::atomic<uint32_t> errors { 0 };
+  std::atomic<uint64_t> bytes { 0 }; //data and register, without address
+  std::atomic<uint64_t> wire_ns { 0 }; //computed at bus clock
+  std::atomic<uint64_t> latency_sum_ns { 0 };
+  std::atomic<uint32_t> latency_max_ns { 0 };
+  std::atomic<uint32_t> histogram[buckets];
+  i2c_counters_t() {
+    for (auto &bucket : histogram) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+  static uint32_t bucket_us(size_t bucket) {
+    return 32u << bucket;
+  }
+  void account(bool read, size_t _bytes, uint32_t latency_ns, bool error);
+  uint32_t getTransfers() const {
+    return reads.load(std::memory_order_relaxed) + writes.load(std::memory_order_relaxed);
+  }
+  uint32_t getLatencyAvgNs() const {
+    const auto transfers = getTransfers();
+    return transfers ? latency_sum_ns.load(std::memory_order_relaxed) / transfers : 0;
+  }
+  void reset();
+};
+
+/***
+ * profile of every transfer on one bus: counters per device and per device register,
+ * bus utilization over sliding window.
+ * Busy time is measured around transfer syscall, wire time is computed from bytes at bus clock.
+ * Register slots are claimed on first use, transfers to registers beyond table are counted as dropped.
+ */
+class CI2cProfile {
+public:
+  static constexpr uint8_t addresses = 128;
+  static constexpr size_t register_slots = 256;
+  static constexpr uint32_t slot_ms = 100;
+  static constexpr size_t window_slots = 10; //window is one second
+private:
+  struct window_slot_t {
+    std::atomic<uint32_t> epoch { 0 }; //slot_ms periods since profile start
+    std::atomic<uint64_t> busy_ns { 0 };
+    std::atomic<uint64_t> wire_ns { 0 };
+  };
+  const uint64_t started_ns_;
+  i2c_counters_t devices_[addresses];
+  std::atomic<uint16_t> register_keys_[register_slots]; //0 - free, else 1 + address << 8 | register
+  i2c_counters_t registers_[register_slots];
+  std::atomic<uint32_t> dropped_ { 0 };
+  window_slot_t window_[window_slots];
+  i2c_counters_t* find_register(uint8_t address, uint8_t reg);
+public:
+  CI2cProfile();
+  static uint64_t now_ns();
+  //transfer done, started_ns - by now_ns()
+  void account(uint8_t address, uint8_t reg, bool read, size_t bytes, uint64_t started_ns, bool error);
+  const i2c_counters_t& getDevice(uint8_t address) const {
+    return devices_[address & 0x7f];
+  }
+  //devices with transfers
+  void devices(const std::function<void(uint8_t address, const i2c_counters_t&)> &visit) const;
+  void registers(const std::function<void(uint8_t address, uint8_t reg, const i2c_counters_t&)> &visit) const;
+  uint32_t getDropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+  //share of sliding window, 0..1
+  float getBusyUtilization() const;
+  float getWireUtilization() const;
+  void reset();
+};
+
+void i2c_profile_bench();
+#endif /* CI2CPROFILE_H_ */
@@ -0,0 +1,833 @@
+/*
+ * CI2cSim.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CI2cSim.h"
+#include <iostream>
+#ifdef _SIMULATION_
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <algorithm>
+#include "CPca9685.h"
+#include "CPower.h"
+#include "CImu.h"
+#endif
+
+using namespace std;
+
+#ifdef _SIMULATION_
+
+constexpr uint8_t CSimPca9685::channels;
+constexpr size_t CSimMpu9250::mem_size;
+
+static uint64_t steady_ns() {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int16_t saturate(float value) {
+  return static_cast<int16_t>(fmaxf(INT16_MIN, fminf(INT16_MAX, roundf(value))));
+}
+
+void CSimPca9685::reset() {
+  lock_guard<mutex> lock(mu_);
+  memset(regs_, 0, sizeof(regs_));
+  regs_[MODE1] = MODE1_SLEEP | 0x01; //ALLCALL
+  regs_[0x01] = 0x04; //MODE2: OUTDRV
+  regs_[0x02] = 0xe2; //SUBADR1..3, ALLCALLADR
+  regs_[0x03] = 0xe4;
+  regs_[0x04] = 0xe8;
+  regs_[0x05] = 0xe0;
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    regs_[LED0_ON_L + 4 * channel + 3] = FULL;
+  }
+  regs_[PRESCALE] = 0x1e; //200 Hz
+  writes_ = 0;
+}
+
+uint8_t CSimPca9685::next(uint8_t reg) const {
+  if (0 == (regs_[MODE1] & MODE1_AI)) {
+    return reg;
+  }
+  //LEDn block rolls over to MODE1
+  return ((LED15_OFF_H == reg) || (0xff == reg)) ? 0 : reg + 1;
+}
+
+void CSimPca9685::write_reg(uint8_t reg, uint8_t value) {
+  if (MODE1 == reg) {
+    regs_[reg] = value & ~MODE1_RESTART; //writing 1 clears restart
+  } else if (PRESCALE == reg) {
+    if (regs_[MODE1] & MODE1_SLEEP) { //ignored while oscillator runs
+      regs_[reg] = max<uint8_t>(value, 3);
+    }
+  } else if ((ALL_LED_ON_L <= reg) && (ALL_LED_OFF_H >= reg)) {
+    for (uint8_t channel = 0; channel < channels; channel++) {
+      regs_[LED0_ON_L + 4 * channel + reg - ALL_LED_ON_L] = value;
+    }
+  } else if ((LED15_OFF_H >= reg) || (0xff == reg)) {
+    regs_[reg] = value;
+  } //reserved
+}
+
+int CSimPca9685::read(uint8_t reg, uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mu_);
+  for (size_t idx = 0; idx < len; idx++) {
+    data[idx] = ((ALL_LED_ON_L <= reg) && (ALL_LED_OFF_H >= reg)) ? 0 : regs_[reg]; //ALL_LED reads 0
+    reg = next(reg);
+  }
+  return 0;
+}
+
+int CSimPca9685::write(const uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mu_);
+  if (0 == len) {
+    return 0;
+  }
+  auto reg = data[0];
+  for (size_t idx = 1; idx < len; idx++) {
+    write_reg(reg, data[idx]);
+    reg = next(reg);
+  }
+  writes_++;
+  return 0;
+}
+
+uint16_t CSimPca9685::getDuty(uint8_t channel) const {
+  lock_guard<mutex> lock(mu_);
+  const auto led = &regs_[LED0_ON_L + 4 * (channel % channels)];
+  if (led[3] & FULL) { //full off wins
+    return 0;
+  }
+  if (led[1] & FULL) {
+    return 4096;
+  }
+  const uint16_t on = led[0] | ((led[1] & 0x0f) << 8);
+  const uint16_t off = led[2] | ((led[3] & 0x0f) << 8);
+  return (off - on) & 0xfff;
+}
+
+uint8_t CSimPca9685::getPrescale() const {
+  lock_guard<mutex> lock(mu_);
+  return regs_[PRESCALE];
+}
+
+bool CSimPca9685::isSleeping() const {
+  lock_guard<mutex> lock(mu_);
+  return regs_[MODE1] & MODE1_SLEEP;
+}
+
+uint32_t CSimPca9685::getWrites() const {
+  lock_guard<mutex> lock(mu_);
+  return writes_;
+}
+
+CSimAds1115::CSimAds1115() {
+  setInput(0, 5000); //5 V rail
+  setInput(1, 0);
+  setInput(2, 0);
+  setInput(3, 3700); //7.4 V battery, 10k+10k divider
+  reset();
+}
+
+void CSimAds1115::reset() {
+  lock_guard<mutex> lock(mu_);
+  pointer_ = REG_CONVERSION;
+  regs_[REG_CONVERSION] = 0;
+  regs_[REG_CONFIG] = 0x0583; //AIN0-AIN1, 2.048 V, single shot, 128 SPS, comparator off
+  regs_[REG_LO_THRESH] = 0x8000;
+  regs_[REG_HI_THRESH] = 0x7fff;
+  converting_ = false;
+  conversions_ = 0;
+}
+
+uint32_t CSimAds1115::conversion_ns(uint16_t config) {
+  static const uint16_t sps[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+  return 1000000000u / sps[(config >> 5) & 7];
+}
+
+int16_t CSimAds1115::convert() const {
+  static const int16_t fsr_mv[8] = { 6144, 4096, 2048, 1024, 512, 256, 256, 256 };
+  //differential pairs, then single ended against GND
+  static const uint8_t positive[4] = { 0, 0, 1, 2 };
+  static const uint8_t negative[4] = { 1, 3, 3, 3 };
+  const auto config = regs_[REG_CONFIG];
+  const auto mux = (config >> 12) & 7;
+  const int32_t mv = (4 <= mux) ? getInput(mux - 4) : getInput(positive[mux]) - getInput(negative[mux]);
+  const auto code = lroundf(mv * 32768.f / fsr_mv[(config >> 9) & 7]);
+  return static_cast<int16_t>(max<long>(INT16_MIN, min<long>(INT16_MAX, code)));
+}
+
+void CSimAds1115::update(uint64_t now_ns) {
+  if (!converting_ || (now_ns < ready_ns_)) {
+    return;
+  }
+  regs_[REG_CONVERSION] = convert();
+  conversions_++;
+  if (regs_[REG_CONFIG] & CONFIG_MODE_SINGLE) {
+    converting_ = false; //powers down
+  } else {
+    ready_ns_ = now_ns + conversion_ns(regs_[REG_CONFIG]);
+  }
+}
+
+int CSimAds1115::read(uint8_t reg, uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mu_);
+  update(steady_ns());
+  pointer_ = reg & 3;
+  auto value = regs_[pointer_];
+  if (REG_CONFIG == pointer_) {
+    value = converting_ ? (value & ~CONFIG_OS) : (value | CONFIG_OS);
+  }
+  for (size_t idx = 0; idx < len; idx++) { //register is repeated
+    data[idx] = (idx & 1) ? (value & 0xff) : (value >> 8);
+  }
+  return 0;
+}
+
+int CSimAds1115::write(const uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mu_);
+  if (0 == len) {
+    return 0;
+  }
+  const auto now = steady_ns();
+  update(now);
+  pointer_ = data[0] & 3;
+  if (3 > len) { //pointer only
+    return 0;
+  }
+  const uint16_t value = (data[1] << 8) | data[2];
+  if (REG_CONFIG == pointer_) {
+    regs_[REG_CONFIG] = value & ~CONFIG_OS;
+    //single shot starts on OS, continuous mode converts all the time
+    if (!(value & CONFIG_MODE_SINGLE) || ((value & CONFIG_OS) && !converting_)) {
+      converting_ = true;
+      ready_ns_ = now + conversion_ns(value);
+    }
+  } else if (REG_CONVERSION != pointer_) {
+    regs_[pointer_] = value;
+  }
+  return 0;
+}
+
+uint32_t CSimAds1115::getConversions() const {
+  lock_guard<mutex> lock(mu_);
+  return conversions_;
+}
+
+//MPU-9250 registers
+static constexpr uint8_t SMPLRT_DIV = 0x19;
+static constexpr uint8_t CONFIG = 0x1a;
+static constexpr uint8_t GYRO_CONFIG = 0x1b;
+static constexpr uint8_t ACCEL_CONFIG = 0x1c;
+static constexpr uint8_t ACCEL_CONFIG2 = 0x1d;
+static constexpr uint8_t FIFO_EN = 0x23;
+static constexpr uint8_t I2C_SLV0_ADDR = 0x25;
+static constexpr uint8_t I2C_SLV0_REG = 0x26;
+static constexpr uint8_t I2C_SLV0_CTRL = 0x27;
+static constexpr uint8_t I2C_SLV4_CTRL = 0x34;
+static constexpr uint8_t INT_PIN_CFG = 0x37;
+static constexpr uint8_t DMP_INT_STATUS = 0x39;
+static constexpr uint8_t INT_STATUS = 0x3a;
+static constexpr uint8_t ACCEL_XOUT_H = 0x3b;
+static constexpr uint8_t TEMP_OUT_H = 0x41;
+static constexpr uint8_t GYRO_XOUT_H = 0x43;
+static constexpr uint8_t EXT_SENS_DATA_00 = 0x49;
+static constexpr uint8_t EXT_SENS_DATA_23 = 0x60;
+static constexpr uint8_t I2C_SLV0_DO = 0x63;
+static constexpr uint8_t I2C_MST_DELAY_CTRL = 0x67;
+static constexpr uint8_t USER_CTRL = 0x6a;
+static constexpr uint8_t PWR_MGMT_1 = 0x6b;
+static constexpr uint8_t BANK_SEL = 0x6d;
+static constexpr uint8_t MEM_START_ADDR = 0x6e;
+static constexpr uint8_t MEM_R_W = 0x6f;
+static constexpr uint8_t FIFO_COUNTH = 0x72;
+static constexpr uint8_t FIFO_COUNTL = 0x73;
+static constexpr uint8_t FIFO_R_W = 0x74;
+static constexpr uint8_t WHO_AM_I = 0x75;
+static constexpr uint8_t CONFIG_FIFO_MODE = 0x40; //full FIFO keeps old data
+static constexpr uint8_t FIFO_EN_TEMP = 0x80;
+static constexpr uint8_t FIFO_EN_GYRO_X = 0x40;
+static constexpr uint8_t FIFO_EN_GYRO_Y = 0x20;
+static constexpr uint8_t FIFO_EN_GYRO_Z = 0x10;
+static constexpr uint8_t FIFO_EN_ACCEL = 0x08;
+static constexpr uint8_t SLV_EN = 0x80;
+static constexpr uint8_t SLV_READ = 0x80;
+static constexpr uint8_t BYPASS_EN = 0x02;
+static constexpr uint8_t FIFO_OFLOW = 0x10;
+static constexpr uint8_t RAW_DATA_RDY = 0x01;
+static constexpr uint8_t USER_DMP_EN = 0x80;
+static constexpr uint8_t USER_FIFO_EN = 0x40;
+static constexpr uint8_t USER_I2C_MST_EN = 0x20;
+static constexpr uint8_t USER_FIFO_RST = 0x04;
+static constexpr uint8_t USER_RESETS = 0x0f; //self clearing
+static constexpr uint8_t H_RESET = 0x80;
+static constexpr uint8_t SLEEP = 0x40;
+//DMP firmware configuration, as inv_mpu_dmp_motion_driver writes it
+static constexpr uint16_t D_0_22 = 22 + 512; //fifo rate divider
+static constexpr uint16_t CFG_LP_QUAT = 2712;
+static constexpr uint16_t CFG_8 = 2718; //6 axis quaternion
+static constexpr uint16_t CFG_GYRO_RAW_DATA = 2722;
+static constexpr uint16_t CFG_15 = 2727; //accel, gyro to FIFO
+static constexpr uint16_t CFG_27 = 2742; //gesture to FIFO
+//AK8963 registers
+static constexpr uint8_t AK_WIA = 0x00;
+static constexpr uint8_t AK_INFO = 0x01;
+static constexpr uint8_t AK_ST1 = 0x02;
+static constexpr uint8_t AK_HXL = 0x03;
+static constexpr uint8_t AK_HZH = 0x08;
+static constexpr uint8_t AK_ST2 = 0x09;
+static constexpr uint8_t AK_CNTL1 = 0x0a;
+static constexpr uint8_t AK_CNTL2 = 0x0b;
+static constexpr uint8_t AK_ASAX = 0x10;
+static constexpr uint8_t AK_ASAZ = 0x12;
+static constexpr uint8_t AK_BIT_16 = 0x10;
+static constexpr uint8_t AK_DRDY = 0x01;
+//motion: level, yaw rate swings +-30 dps with 20 s period, stands while swing is low
+static constexpr float yaw_rate_max = 30;
+static constexpr float swing_s = 20;
+//field 20 uT north, 40 uT down at 0.15 uT/LSB
+static constexpr float field_h = 133;
+static constexpr float field_v = 267;
+//chip offsets, removed by calibration
+static const float gyro_offset_dps[3] = { 0.8f, -0.5f, 0.3f };
+static const float accel_offset_g[3] = { 0.01f, -0.02f, 0.03f };
+
+CSimMpu9250::CSimMpu9250() {
+  memset(mem_, 0, sizeof(mem_));
+  power_on();
+}
+
+void CSimMpu9250::reset() {
+  lock_guard<mutex> lock(mu_);
+  power_on();
+}
+
+void CSimMpu9250::power_on() {
+  memset(regs_, 0, sizeof(regs_));
+  regs_[PWR_MGMT_1] = 0x01; //auto clock select
+  regs_[WHO_AM_I] = WHO_AM_I_VALUE;
+  fifo_head_ = 0;
+  fifo_count_ = 0;
+  count_latch_ = 0;
+  compass_cntl_ = 0;
+  compass_ready_ = false;
+  next_sample_us_ = now_us() + period_us();
+}
+
+uint64_t CSimMpu9250::now_us() const {
+  return manual_clock_ ? time_us_ : steady_ns() / 1000;
+}
+
+uint32_t CSimMpu9250::period_us() const {
+  //internal rate 1 kHz with DLPF, 8 kHz without
+  const auto dlpf = regs_[CONFIG] & 7;
+  uint32_t period = ((0 == dlpf) || (7 == dlpf) ? 125 : 1000) * (1 + regs_[SMPLRT_DIV]);
+  if (regs_[USER_CTRL] & USER_DMP_EN) {
+    period *= 1 + ((mem_[D_0_22] << 8) | mem_[D_0_22 + 1]);
+  }
+  return period;
+}
+
+size_t CSimMpu9250::fifo_size() const {
+  return min<size_t>(512 << ((regs_[ACCEL_CONFIG2] >> 6) & 3), mem_size);
+}
+
+size_t CSimMpu9250::packet_bytes() const {
+  if (0 == (regs_[USER_CTRL] & USER_FIFO_EN)) {
+    return 0;
+  }
+  size_t bytes = 0;
+  if (regs_[USER_CTRL] & USER_DMP_EN) {
+    bytes += ((0x8b != mem_[CFG_LP_QUAT]) || (0xa3 != mem_[CFG_8])) ? 16 : 0;
+    bytes += (0xa3 != mem_[CFG_15 + 1]) ? 6 : 0;
+    bytes += (0xa3 != mem_[CFG_15 + 4]) ? 6 : 0;
+    bytes += (0xd8 != mem_[CFG_27]) ? 4 : 0;
+    return bytes;
+  }
+  const auto fifo_en = regs_[FIFO_EN];
+  bytes += (fifo_en & FIFO_EN_ACCEL) ? 6 : 0;
+  bytes += (fifo_en & FIFO_EN_TEMP) ? 2 : 0;
+  bytes += (fifo_en & FIFO_EN_GYRO_X) ? 2 : 0;
+  bytes += (fifo_en & FIFO_EN_GYRO_Y) ? 2 : 0;
+  bytes += (fifo_en & FIFO_EN_GYRO_Z) ? 2 : 0;
+  return bytes;
+}
+
+void CSimMpu9250::run(uint64_t now) {
+  const auto period = period_us();
+  if (regs_[PWR_MGMT_1] & SLEEP) {
+    next_sample_us_ = now + period;
+    return;
+  }
+  if (now < next_sample_us_) {
+    return;
+  }
+  auto due = (now - next_sample_us_) / period + 1;
+  //samples which would be overwritten in FIFO anyway move motion only
+  const auto keep = fifo_size() / max<size_t>(packet_bytes(), 1) + 1;
+  for (; due > keep; due--) {
+    step(period / 1e6f);
+    next_sample_us_ += period;
+  }
+  for (; due; due--) {
+    step(period / 1e6f);
+    sample();
+    next_sample_us_ += period;
+  }
+}
+
+void CSimMpu9250::step(float dt) {
+  seq_++;
+  samples_++;
+  motion_s_ = fmodf(motion_s_ + dt, swing_s);
+  const auto swing = sinf(2 * static_cast<float>(M_PI) * motion_s_ / swing_s);
+  yaw_rate_ = yaw_rate_max * copysignf(fmaxf(0, fabsf(swing) - 0.5f) * 2, swing);
+  yaw_ += yaw_rate_ * dt * static_cast<float>(M_PI) / 180;
+  //AK8963 axes, 14 bit output is 4 times coarser
+  const auto scale = (compass_cntl_ & AK_BIT_16) ? 1.f : 0.25f;
+  mag_[0] = saturate(-field_h * sinf(yaw_) * scale);
+  mag_[1] = saturate(field_h * cosf(yaw_) * scale);
+  mag_[2] = saturate(field_v * scale);
+}
+
+static uint8_t* put16(uint8_t *p, int16_t value) {
+  *p++ = static_cast<uint16_t>(value) >> 8;
+  *p++ = value & 0xff;
+  return p;
+}
+
+static uint8_t* put32(uint8_t *p, int32_t value) {
+  p = put16(p, static_cast<int16_t>(static_cast<uint32_t>(value) >> 16));
+  return put16(p, static_cast<int16_t>(value & 0xffff));
+}
+
+void CSimMpu9250::sample() {
+  const auto gyro_sens = 131.f / (1 << ((regs_[GYRO_CONFIG] >> 3) & 3));
+  const auto accel_sens = static_cast<float>(16384 >> ((regs_[ACCEL_CONFIG] >> 3) & 3));
+  const float noise = static_cast<float>(seq_ * 7 % 11) - 5;
+  const int16_t accel[3] = { saturate(accel_offset_g[0] * accel_sens + noise), saturate(accel_offset_g[1] * accel_sens
+      - noise), saturate((accel_offset_g[2] + 1) * accel_sens + noise) };
+  const int16_t gyro[3] = { saturate(gyro_offset_dps[0] * gyro_sens + noise), saturate(gyro_offset_dps[1] * gyro_sens
+      + noise), saturate((gyro_offset_dps[2] + yaw_rate_) * gyro_sens + noise) };
+  auto p = &regs_[ACCEL_XOUT_H];
+  for (const auto value : accel) {
+    p = put16(p, value);
+  }
+  p = put16(&regs_[TEMP_OUT_H], 0); //21 C
+  for (const auto value : gyro) {
+    p = put16(p, value);
+  }
+  regs_[INT_STATUS] |= RAW_DATA_RDY;
+  //I2C master: slave 0 reads compass back, slave 1 starts next single measurement,
+  //slaves with delay enabled run every 1 + I2C_MST_DLY samples
+  if (regs_[USER_CTRL] & USER_I2C_MST_EN) {
+    const auto divider = 1u + (regs_[I2C_SLV4_CTRL] & 0x1f);
+    for (uint8_t slave = 0; slave < 2; slave++) {
+      const auto addr = regs_[I2C_SLV0_ADDR + 3 * slave];
+      const auto reg = regs_[I2C_SLV0_REG + 3 * slave];
+      const auto ctrl = regs_[I2C_SLV0_CTRL + 3 * slave];
+      if (!(ctrl & SLV_EN) || (COMPASS_ADDRESS != (addr & 0x7f))
+          || ((regs_[I2C_MST_DELAY_CTRL] & (1 << slave)) && (0 != seq_ % divider))) {
+        continue;
+      }
+      if (addr & SLV_READ) {
+        const auto len = min<size_t>(ctrl & 0x0f, EXT_SENS_DATA_23 - EXT_SENS_DATA_00 + 1);
+        for (size_t idx = 0; idx < len; idx++) {
+          regs_[EXT_SENS_DATA_00 + idx] = compass_reg(reg + idx);
+        }
+      } else {
+        compass_write(reg, regs_[I2C_SLV0_DO + slave]);
+      }
+    }
+  }
+  const auto bytes = packet_bytes();
+  if (0 == bytes) {
+    return;
+  }
+  uint8_t packet[32];
+  p = packet;
+  if (regs_[USER_CTRL] & USER_DMP_EN) {
+    constexpr float q30 = 1 << 30;
+    if ((0x8b != mem_[CFG_LP_QUAT]) || (0xa3 != mem_[CFG_8])) {
+      p = put32(p, static_cast<int32_t>(cosf(yaw_ / 2) * q30));
+      p = put32(p, 0);
+      p = put32(p, 0);
+      p = put32(p, static_cast<int32_t>(sinf(yaw_ / 2) * q30));
+    }
+    if (0xa3 != mem_[CFG_15 + 1]) {
+      for (const auto value : accel) {
+        p = put16(p, value);
+      }
+    }
+    if (0xa3 != mem_[CFG_15 + 4]) {
+      //calibrated gyro has chip offsets removed by DMP
+      const auto calibrated = 0xb2 == mem_[CFG_GYRO_RAW_DATA];
+      for (auto axis = 0; axis < 3; axis++) {
+        p = put16(p, calibrated ? saturate(gyro[axis] - gyro_offset_dps[axis] * gyro_sens) : gyro[axis]);
+      }
+    }
+    if (0xd8 != mem_[CFG_27]) {
+      p = put32(p, 0); //no tap, no orientation change
+    }
+  } else {
+    const auto fifo_en = regs_[FIFO_EN];
+    if (fifo_en & FIFO_EN_ACCEL) { //register order
+      memcpy(p, &regs_[ACCEL_XOUT_H], 6);
+      p += 6;
+    }
+    if (fifo_en & FIFO_EN_TEMP) {
+      memcpy(p, &regs_[TEMP_OUT_H], 2);
+      p += 2;
+    }
+    for (auto axis = 0; axis < 3; axis++) {
+      if (fifo_en & (FIFO_EN_GYRO_X >> axis)) {
+        memcpy(p, &regs_[GYRO_XOUT_H + 2 * axis], 2);
+        p += 2;
+      }
+    }
+  }
+  fifo_push(packet, p - packet);
+}
+
+void CSimMpu9250::fifo_push(const uint8_t *data, size_t len) {
+  const auto size = fifo_size();
+  for (size_t idx = 0; idx < len; idx++) {
+    if (size == fifo_count_) {
+      if (0 == (regs_[INT_STATUS] & FIFO_OFLOW)) {
+        overflows_++;
+      }
+      regs_[INT_STATUS] |= FIFO_OFLOW;
+      if (regs_[CONFIG] & CONFIG_FIFO_MODE) {
+        return;
+      }
+      fifo_head_ = (fifo_head_ + 1) % size; //oldest byte is overwritten
+      fifo_count_--;
+    }
+    fifo_[(fifo_head_ + fifo_count_) % size] = data[idx];
+    fifo_count_++;
+  }
+}
+
+uint8_t CSimMpu9250::read_reg(uint8_t reg) {
+  switch (reg) {
+    case FIFO_COUNTH:
+      count_latch_ = static_cast<uint16_t>(fifo_count_);
+      return count_latch_ >> 8;
+    case FIFO_COUNTL:
+      return count_latch_ & 0xff;
+    case FIFO_R_W: {
+      if (0 == fifo_count_) {
+        return 0;
+      }
+      const auto value = fifo_[fifo_head_];
+      fifo_head_ = (fifo_head_ + 1) % fifo_size();
+      fifo_count_--;
+      return value;
+    }
+    case MEM_R_W: {
+      const auto value = mem_[((regs_[BANK_SEL] << 8) | regs_[MEM_START_ADDR]) % mem_size];
+      regs_[MEM_START_ADDR]++;
+      return value;
+    }
+    case INT_STATUS:
+    case DMP_INT_STATUS: { //cleared by read
+      const auto value = regs_[reg];
+      regs_[reg] = 0;
+      return value;
+    }
+    default:
+      return regs_[reg & 0x7f];
+  }
+}
+
+void CSimMpu9250::write_reg(uint8_t reg, uint8_t value) {
+  switch (reg) {
+    case PWR_MGMT_1:
+      if (value & H_RESET) {
+        power_on();
+      } else {
+        regs_[reg] = value;
+      }
+      break;
+    case USER_CTRL:
+      if (value & USER_FIFO_RST) {
+        fifo_head_ = 0;
+        fifo_count_ = 0;
+      }
+      regs_[reg] = value & ~USER_RESETS;
+      break;
+    case ACCEL_CONFIG2:
+      if ((regs_[reg] ^ value) & 0xc0) { //FIFO size changed
+        fifo_head_ = 0;
+        fifo_count_ = 0;
+      }
+      regs_[reg] = value;
+      break;
+    case MEM_R_W:
+      mem_[((regs_[BANK_SEL] << 8) | regs_[MEM_START_ADDR]) % mem_size] = value;
+      regs_[MEM_START_ADDR]++;
+      break;
+    case DMP_INT_STATUS:
+    case INT_STATUS:
+    case FIFO_COUNTH:
+    case FIFO_COUNTL:
+    case FIFO_R_W:
+    case WHO_AM_I:
+      break;
+    default:
+      if (((ACCEL_XOUT_H <= reg) && (EXT_SENS_DATA_23 >= reg)) || (0x7f < reg)) { //read only
+        break;
+      }
+      regs_[reg] = value;
+      break;
+  }
+}
+
+int CSimMpu9250::read(uint8_t reg, uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mu_);
+  run(now_us());
+  for (size_t idx = 0; idx < len; idx++) {
+    data[idx] = read_reg(reg);
+    if ((FIFO_R_W != reg) && (MEM_R_W != reg)) { //streams stay on register
+      reg++;
+    }
+  }
+  return 0;
+}
+
+int CSimMpu9250::write(const uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mu_);
+  run(now_us());
+  if (0 == len) {
+    return 0;
+  }
+  auto reg = data[0];
+  for (size_t idx = 1; idx < len; idx++) {
+    write_reg(reg, data[idx]);
+    if ((FIFO_R_W != reg) && (MEM_R_W != reg)) {
+      reg++;
+    }
+  }
+  return 0;
+}
+
+bool CSimMpu9250::compass_visible() const {
+  return (regs_[INT_PIN_CFG] & BYPASS_EN) && !(regs_[USER_CTRL] & USER_I2C_MST_EN);
+}
+
+uint8_t CSimMpu9250::compass_reg(uint8_t reg) {
+  if ((AK_HXL <= reg) && (AK_HZH >= reg)) { //little endian
+    const auto value = static_cast<uint16_t>(mag_[(reg - AK_HXL) / 2]);
+    return ((reg - AK_HXL) & 1) ? (value >> 8) : (value & 0xff);
+  }
+  if ((AK_ASAX <= reg) && (AK_ASAZ >= reg)) {
+    return 128; //sensitivity adjustment 1.0
+  }
+  switch (reg) {
+    case AK_WIA:
+      return 0x48;
+    case AK_INFO:
+      return 0x9a;
+    case AK_ST1:
+      return compass_ready_ ? AK_DRDY : 0;
+    case AK_ST2: {
+      //end of data read, single measurement returns to power down
+      const auto mode = compass_cntl_ & 0x0f;
+      compass_ready_ = compass_ready_ && (1 != mode) && (0 != mode);
+      if (1 == mode) {
+        compass_cntl_ &= AK_BIT_16;
+      }
+      return compass_cntl_ & AK_BIT_16;
+    }
+    case AK_CNTL1:
+      return compass_cntl_;
+    default:
+      return 0;
+  }
+}
+
+void CSimMpu9250::compass_write(uint8_t reg, uint8_t value) {
+  if (AK_CNTL1 == reg) {
+    compass_cntl_ = value;
+    const auto mode = value & 0x0f;
+    compass_ready_ = (1 == mode) || (2 == mode) || (6 == mode); //measurement is done at once
+  } else if ((AK_CNTL2 == reg) && (value & 0x01)) { //soft reset
+    compass_cntl_ = 0;
+    compass_ready_ = false;
+  }
+}
+
+int CSimMpu9250::CCompass::read(uint8_t reg, uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mpu_.mu_);
+  if (!mpu_.compass_visible()) {
+    return -1;
+  }
+  mpu_.run(mpu_.now_us());
+  for (size_t idx = 0; idx < len; idx++) {
+    data[idx] = mpu_.compass_reg(reg++);
+  }
+  return 0;
+}
+
+int CSimMpu9250::CCompass::write(const uint8_t *data, size_t len) {
+  lock_guard<mutex> lock(mpu_.mu_);
+  if (!mpu_.compass_visible()) {
+    return -1;
+  }
+  if (0 == len) {
+    return 0;
+  }
+  auto reg = data[0];
+  for (size_t idx = 1; idx < len; idx++) {
+    mpu_.compass_write(reg++, data[idx]);
+  }
+  return 0;
+}
+
+void CSimMpu9250::setManualClock(bool manual) {
+  lock_guard<mutex> lock(mu_);
+  const auto now = now_us();
+  run(now);
+  //schedule continues from current time of new clock
+  const auto wait_us = (next_sample_us_ > now) ? next_sample_us_ - now : 0;
+  manual_clock_ = manual;
+  time_us_ = steady_ns() / 1000;
+  next_sample_us_ = now_us() + wait_us;
+}
+
+void CSimMpu9250::advance(uint32_t us) {
+  lock_guard<mutex> lock(mu_);
+  time_us_ += us;
+  run(now_us());
+}
+
+uint32_t CSimMpu9250::getSamples() const {
+  lock_guard<mutex> lock(mu_);
+  return samples_;
+}
+
+uint32_t CSimMpu9250::getOverflows() const {
+  lock_guard<mutex> lock(mu_);
+  return overflows_;
+}
+
+template<typename T>
+static T& sim_device(uint8_t bus, uint8_t address) {
+  static mutex mu;
+  static map<uint16_t, T*> devices;
+  lock_guard<mutex> lock(mu);
+  auto &found = devices[(bus << 8) | address];
+  if (!found) {
+    found = new T;
+    i2c_bus(bus).attach(address, found);
+  }
+  return *found;
+}
+
+CSimPca9685& sim_pca9685(uint8_t bus, uint8_t address) {
+  return sim_device<CSimPca9685>(bus, address);
+}
+
+CSimAds1115& sim_ads1115(uint8_t bus, uint8_t address) {
+  return sim_device<CSimAds1115>(bus, address);
+}
+
+CSimMpu9250& sim_mpu9250(uint8_t bus, uint8_t address) {
+  auto &mpu = sim_device<CSimMpu9250>(bus, address);
+  i2c_bus(bus).attach(CSimMpu9250::COMPASS_ADDRESS, &mpu.getCompass());
+  return mpu;
+}
+
+void i2c_sim_robot() {
+  sim_pca9685(1, 0x40);
+  sim_ads1115(1, 0x48);
+  sim_mpu9250(1, CSimMpu9250::ADDRESS);
+}
+#endif
+
+void i2c_sim_bench() {
+#ifndef _SIMULATION_
+  cout << "i2c sim bench runs on simulated bus, build with SIMULATION=1" << endl;
+#else
+  //robot drivers against device models of bus 1
+  i2c_sim_robot();
+  auto &bus = i2c_bus(1);
+  auto &pca = sim_pca9685(1, 0x40);
+  auto &ads = sim_ads1115(1, 0x48);
+  auto &mpu = sim_mpu9250(1, CSimMpu9250::ADDRESS);
+  {
+    CPca9685 dev(1, 0x40);
+    const auto inited = dev.init(50);
+    dev.stop(); //frames are written in this thread
+    pwm_cmd_t cmd;
+    cmd.mask = 0xffff;
+    for (uint8_t channel = 0; channel < CPca9685::channels; channel++) {
+      cmd.value[channel] = (0 == channel) ? 0 : ((1 == channel) ? CPca9685::maxPWM : 200 + 25 * channel);
+    }
+    dev.write(cmd);
+    uint8_t mismatched = 0;
+    for (uint8_t channel = 0; channel < CPca9685::channels; channel++) {
+      mismatched += pca.getDuty(channel) != cmd.value[channel];
+    }
+    cout << "i2c sim pca9685 init=" << inited << " prescale=" << static_cast<unsigned>(pca.getPrescale())
+        << " sleeping=" << pca.isSleeping() << " mismatched channels=" << static_cast<unsigned>(mismatched) << endl;
+  }
+  CPower power; //same bus and address as robot one
+  {
+    ads.setInput(0, 4900); //5 V rail
+    ads.setInput(3, 3650); //battery through divider
+    cout << "i2c sim ads1115 init=" << power.init() << " 5V=" << power.get5V() << "mV VBAT=" << power.getVBAT()
+        << "mV conversions=" << ads.getConversions() << endl;
+    ads.reset();
+  }
+  for (const auto dmp : { false, true }) {
+    constexpr uint16_t rate_hz = 200;
+    constexpr uint32_t seconds = 2;
+    const auto samples = imu.getSamples();
+    const auto errors = imu.getErrors();
+    const auto overflows = mpu.getOverflows();
+    imu.start(rate_hz, dmp);
+    while (!imu.isReady()) { //setup resets chip and loads DMP firmware
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    this_thread::sleep_for(chrono::seconds(seconds));
+    imu_state_t state { };
+    imu.getState(state);
+    imu.stop();
+    cout << "i2c sim mpu9250 " << (dmp ? "dmp" : "raw") << " samples=" << imu.getSamples() - samples << "/"
+        << rate_hz * seconds << " errors=" << imu.getErrors() - errors << " overflows=" << mpu.getOverflows() - overflows
+        << " yaw=" << state.yaw << "deg gyro z=" << state.gyro[2] << "dps" << endl;
+  }
+  //transfer cost: driver and controller overhead over wire time
+  for (const uint32_t latency_us : { 0u, 100u, 500u }) {
+    bus.setBusDelay(true);
+    bus.setLatency(latency_us * 1000);
+    CPca9685 dev(1, 0x40);
+    dev.init(0);
+    dev.stop();
+    constexpr auto frames = 100;
+    pwm_cmd_t cmd;
+    cmd.mask = 0xffff;
+    auto started = chrono::steady_clock::now();
+    for (auto frame = 0; frame < frames; frame++) {
+      for (uint8_t channel = 0; channel < CPca9685::channels; channel++) {
+        cmd.value[channel] = 200 + (frame + channel) % 400;
+      }
+      dev.write(cmd);
+    }
+    const auto frame_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count()
+        / frames;
+    started = chrono::steady_clock::now();
+    power.get5V();
+    const auto adc_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+    cout << "i2c sim latency=" << latency_us << "us pwm frame=" << frame_us << "us adc read=" << adc_us << "us" << endl;
+  }
+  bus.setBusDelay(false);
+  bus.setLatency(0);
+#endif
+}
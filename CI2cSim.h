@@ -0,0 +1,186 @@
+/*
+ * CI2cSim.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CI2CSIM_H_
+#define CI2CSIM_H_
+#ifdef _SIMULATION_
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include "CI2cBus.h"
+
+/***
+ * PCA9685 model: MODE1 sleep and auto-increment, PRESCALE written in sleep only,
+ * LEDn registers and ALL_LED writing every channel.
+ * Without auto-increment block write stays on first register.
+ */
+class CSimPca9685: public CI2cDevice {
+public:
+  static constexpr uint8_t channels = 16;
+  static constexpr uint8_t MODE1 = 0x00;
+  static constexpr uint8_t LED0_ON_L = 0x06;
+  static constexpr uint8_t LED15_OFF_H = 0x45;
+  static constexpr uint8_t ALL_LED_ON_L = 0xfa;
+  static constexpr uint8_t ALL_LED_OFF_H = 0xfd;
+  static constexpr uint8_t PRESCALE = 0xfe;
+  static constexpr uint8_t MODE1_RESTART = 0x80;
+  static constexpr uint8_t MODE1_AI = 0x20;
+  static constexpr uint8_t MODE1_SLEEP = 0x10;
+  static constexpr uint8_t FULL = 0x10; //bit 4 of LEDn_ON_H, LEDn_OFF_H
+private:
+  mutable std::mutex mu_;
+  uint8_t regs_[256];
+  uint32_t writes_ = 0;
+  uint8_t next(uint8_t reg) const;
+  void write_reg(uint8_t reg, uint8_t value);
+public:
+  CSimPca9685() {
+    reset();
+  }
+  //power on state: sleep, all channels full off
+  void reset();
+  int read(uint8_t reg, uint8_t *data, size_t len) override;
+  int write(const uint8_t *data, size_t len) override;
+  //output high time in 1/4096 of period: 0 - full off, 4096 - full on
+  uint16_t getDuty(uint8_t channel) const;
+  uint8_t getPrescale() const;
+  bool isSleeping() const;
+  uint32_t getWrites() const;
+};
+
+/***
+ * ADS1115 model: pointer register, config, conversion and threshold registers.
+ * Single shot conversion started by OS bit takes 1/data rate, OS reads 0 meanwhile,
+ * result is input voltage of selected mux at selected full scale.
+ * Inputs default to robot wiring: 5 V rail on AIN0, 2S battery through 1:2 divider on AIN3.
+ */
+class CSimAds1115: public CI2cDevice {
+public:
+  static constexpr uint8_t REG_CONVERSION = 0x00;
+  static constexpr uint8_t REG_CONFIG = 0x01;
+  static constexpr uint8_t REG_LO_THRESH = 0x02;
+  static constexpr uint8_t REG_HI_THRESH = 0x03;
+  static constexpr uint16_t CONFIG_OS = 0x8000;
+  static constexpr uint16_t CONFIG_MODE_SINGLE = 0x0100;
+private:
+  mutable std::mutex mu_;
+  uint8_t pointer_ = REG_CONVERSION;
+  uint16_t regs_[4];
+  uint64_t ready_ns_ = 0; //conversion in progress until
+  bool converting_ = false;
+  uint32_t conversions_ = 0;
+  std::atomic<int16_t> inputs_mv_[4];
+  void update(uint64_t now_ns);
+  int16_t convert() const;
+public:
+  CSimAds1115();
+  //power on state
+  void reset();
+  int read(uint8_t reg, uint8_t *data, size_t len) override;
+  int write(const uint8_t *data, size_t len) override;
+  //conversion time by data rate bits of config
+  static uint32_t conversion_ns(uint16_t config);
+  void setInput(uint8_t ain, int16_t mv) {
+    inputs_mv_[ain & 3].store(mv, std::memory_order_relaxed);
+  }
+  int16_t getInput(uint8_t ain) const {
+    return inputs_mv_[ain & 3].load(std::memory_order_relaxed);
+  }
+  uint32_t getConversions() const;
+};
+
+/***
+ * MPU-9250 model with AK8963 behind it.
+ * Register file with reset, sample rate divider and full scale ranges, FIFO with
+ * count registers, overflow status and FIFO mode, DMP memory banks. I2C master slaves 0 and 1
+ * read compass to EXT_SENS_DATA and start its measurements. DMP packets are laid out
+ * as firmware configuration written to memory says: quaternion, accel, gyro, gesture.
+ * Chip samples on own clock, steady clock or stepped by advance(), data of level robot
+ * turning in place: yaw rate swings +-30 dps with 20 s period and stands while swing is low,
+ * chip offsets on every axis. AK8963 answers on own address in bypass mode only.
+ */
+class CSimMpu9250: public CI2cDevice {
+public:
+  static constexpr uint8_t ADDRESS = 0x68;
+  static constexpr uint8_t COMPASS_ADDRESS = 0x0c;
+  static constexpr uint8_t WHO_AM_I_VALUE = 0x71;
+  static constexpr size_t mem_size = 4096; //DMP memory, FIFO takes part of it
+private:
+  class CCompass: public CI2cDevice {
+    CSimMpu9250 &mpu_;
+  public:
+    CCompass(CSimMpu9250 &mpu) :
+        mpu_(mpu) {
+    }
+    int read(uint8_t reg, uint8_t *data, size_t len) override;
+    int write(const uint8_t *data, size_t len) override;
+  };
+  mutable std::mutex mu_;
+  uint8_t regs_[128];
+  uint8_t mem_[mem_size];
+  uint8_t fifo_[mem_size];
+  size_t fifo_head_ = 0;
+  size_t fifo_count_ = 0;
+  uint16_t count_latch_ = 0; //FIFO_COUNTH read latches FIFO_COUNTL
+  //AK8963
+  uint8_t compass_cntl_ = 0;
+  bool compass_ready_ = false;
+  CCompass compass_ { *this };
+  //clock
+  bool manual_clock_ = false;
+  uint64_t time_us_ = 0;
+  uint64_t next_sample_us_ = 0;
+  //motion
+  uint32_t seq_ = 0;
+  float motion_s_ = 0;
+  float yaw_ = 0; //rad
+  float yaw_rate_ = 0; //dps
+  int16_t mag_[3] = { };
+  uint32_t samples_ = 0;
+  uint32_t overflows_ = 0;
+  uint64_t now_us() const;
+  uint32_t period_us() const;
+  size_t fifo_size() const;
+  size_t packet_bytes() const;
+  void run(uint64_t now_us);
+  void step(float dt);
+  void sample();
+  void fifo_push(const uint8_t *data, size_t len);
+  uint8_t read_reg(uint8_t reg);
+  void write_reg(uint8_t reg, uint8_t value);
+  void power_on();
+  uint8_t compass_reg(uint8_t reg);
+  void compass_write(uint8_t reg, uint8_t value);
+  bool compass_visible() const;
+public:
+  CSimMpu9250();
+  //power on state, DMP memory is kept
+  void reset();
+  int read(uint8_t reg, uint8_t *data, size_t len) override;
+  int write(const uint8_t *data, size_t len) override;
+  CI2cDevice& getCompass() {
+    return compass_;
+  }
+  //manual: chip time moves by advance() only, bench runs faster than real time
+  void setManualClock(bool manual);
+  void advance(uint32_t us);
+  uint32_t getSamples() const;
+  uint32_t getOverflows() const;
+};
+
+//models on shared buses: created and attached on first use, never freed as bus threads may outlive them
+CSimPca9685& sim_pca9685(uint8_t bus, uint8_t address);
+CSimAds1115& sim_ads1115(uint8_t bus, uint8_t address);
+//and AK8963 at its address
+CSimMpu9250& sim_mpu9250(uint8_t bus, uint8_t address);
+//devices of robot bus 1: pwm board, power adc, imu
+void i2c_sim_robot();
+#endif
+
+void i2c_sim_bench();
+#endif /* CI2CSIM_H_ */
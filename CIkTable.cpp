@@ -0,0 +1,150 @@
+/*
+ * CIkTable.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CIkTable.h"
+#include "CManipulator.h"
+#include <math.h>
+#include <stdlib.h>
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+void CIkTable::build(float step, float reach, float reach_min, solver_t solver) {
+  step_ = step;
+  inv_step_ = 1 / step;
+  r_min_ = 0;
+  h_min_ = -reach;
+  d2_min_ = reach_min * reach_min;
+  cols_ = static_cast<int>(ceilf(reach / step)) + 1;
+  rows_ = static_cast<int>(ceilf(2 * reach / step)) + 1;
+  nodes_.assign(cols_ * rows_, { 0, 0 });
+  vector<uint8_t> node_ok(cols_ * rows_, 0);
+  for (int row = 0; row < rows_; row++) {
+    for (int col = 0; col < cols_; col++) {
+      double shoulder;
+      double elbow;
+      const auto idx = row * cols_ + col;
+      if (0 == solver(r_min_ + col * step, h_min_ + row * step, shoulder, elbow)) {
+        nodes_[idx] = { static_cast<float>(shoulder), static_cast<float>(elbow) };
+        node_ok[idx] = 1;
+      }
+    }
+  }
+  cell_ok_.assign(cols_ * rows_, 0);
+  for (int row = 0; row + 1 < rows_; row++) {
+    for (int col = 0; col + 1 < cols_; col++) {
+      const int corners[] = { row * cols_ + col, row * cols_ + col + 1, (row + 1) * cols_ + col, (row + 1) * cols_
+          + col + 1 };
+      auto ok = true;
+      for (const auto corner : corners) {
+        ok = ok && node_ok[corner]
+            && (max_corner_diff > fabsf(nodes_[corner].shoulder - nodes_[corners[0]].shoulder))
+            && (max_corner_diff > fabsf(nodes_[corner].elbow - nodes_[corners[0]].elbow));
+      }
+      cell_ok_[row * cols_ + col] = ok;
+    }
+  }
+}
+
+bool CIkTable::lookup(float R, float H, float &shoulder, float &elbow) const {
+  if (nodes_.empty() || (R * R + H * H < d2_min_)) {
+    return false;
+  }
+  const auto fc = (R - r_min_) * inv_step_;
+  const auto fr = (H - h_min_) * inv_step_;
+  const auto col = static_cast<int>(fc);
+  const auto row = static_cast<int>(fr);
+  if ((0 > fc) || (0 > fr) || (col + 1 >= cols_) || (row + 1 >= rows_)) {
+    return false;
+  }
+  const auto idx = row * cols_ + col;
+  if (!cell_ok_[idx]) {
+    return false;
+  }
+  const auto tc = fc - col;
+  const auto tr = fr - row;
+  const auto &n00 = nodes_[idx];
+  const auto &n01 = nodes_[idx + 1];
+  const auto &n10 = nodes_[idx + cols_];
+  const auto &n11 = nodes_[idx + cols_ + 1];
+  const auto s0 = n00.shoulder + (n01.shoulder - n00.shoulder) * tc;
+  const auto s1 = n10.shoulder + (n11.shoulder - n10.shoulder) * tc;
+  const auto e0 = n00.elbow + (n01.elbow - n00.elbow) * tc;
+  const auto e1 = n10.elbow + (n11.elbow - n10.elbow) * tc;
+  shoulder = s0 + (s1 - s0) * tr;
+  elbow = e0 + (e1 - e0) * tr;
+  return true;
+}
+
+void ik_bench() {
+  constexpr auto samples = 200000;
+  //random targets over workspace bounding box, same for both paths
+  vector<pair<float, float>> targets(samples);
+  srand(1);
+  for (auto &target : targets) {
+    target.first = static_cast<float>(rand()) / RAND_MAX * CManipulator::d_Max;
+    target.second = (static_cast<float>(rand()) / RAND_MAX * 2 - 1) * CManipulator::d_Max;
+  }
+  for (const auto step : { 4.f, 2.f, 1.f }) {
+    CIkTable table;
+    auto started = chrono::steady_clock::now();
+    table.build(step, CManipulator::d_Max, CManipulator::d_Min, CManipulator::InverseKinematicsTransform);
+    const auto build_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+
+    //accuracy against analytic solver, int16 degree is what servo gets
+    size_t reachable = 0;
+    size_t covered = 0;
+    size_t int_diff = 0;
+    double err_sum = 0;
+    double err_max = 0;
+    for (const auto &target : targets) {
+      double shoulder;
+      double elbow;
+      if (0 != CManipulator::InverseKinematicsTransform(target.first, target.second, shoulder, elbow)) {
+        continue;
+      }
+      reachable++;
+      float shoulder_t;
+      float elbow_t;
+      if (!table.lookup(target.first, target.second, shoulder_t, elbow_t)) {
+        continue;
+      }
+      covered++;
+      const auto err = max(fabs(shoulder_t - shoulder), fabs(elbow_t - elbow));
+      err_sum += err;
+      err_max = max(err_max, err);
+      int_diff += (static_cast<int16_t>(shoulder_t) != static_cast<int16_t>(shoulder))
+          || (static_cast<int16_t>(elbow_t) != static_cast<int16_t>(elbow));
+    }
+    //cost of both paths
+    volatile float sink = 0;
+    started = chrono::steady_clock::now();
+    for (const auto &target : targets) {
+      double shoulder;
+      double elbow;
+      if (0 == CManipulator::InverseKinematicsTransform(target.first, target.second, shoulder, elbow)) {
+        sink = sink + shoulder + elbow;
+      }
+    }
+    const auto analytic_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    started = chrono::steady_clock::now();
+    for (const auto &target : targets) {
+      float shoulder;
+      float elbow;
+      if (table.lookup(target.first, target.second, shoulder, elbow)) {
+        sink = sink + shoulder + elbow;
+      }
+    }
+    const auto table_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    cout << "ik table step=" << step << "mm size=" << table.getBytes() / 1024 << "KB build=" << build_us / 1000
+        << "ms coverage=" << 100.f * covered / max<size_t>(reachable, 1) << "% err avg="
+        << err_sum / max<size_t>(covered, 1) << " max=" << err_max << "deg int16 differs=" << 100.f * int_diff
+        / max<size_t>(covered, 1) << "% | analytic=" << analytic_ns / samples << "ns table=" << table_ns / samples
+        << "ns per call" << endl;
+  }
+}
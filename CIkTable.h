@@ -0,0 +1,51 @@
+/*
+ * CIkTable.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CIKTABLE_H_
+#define CIKTABLE_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/***
+ * precomputed 2 link inverse kinematics over (R, H) grid,
+ * bilinear interpolation of shoulder/elbow angles.
+ * Cell is usable when all 4 corners are solvable and angles are continuous,
+ * otherwise lookup fails and caller falls back to analytic solver
+ */
+class CIkTable {
+public:
+  using solver_t = int (*)(double R, double H, double &Shoulder, double &Elbow);
+  static constexpr float max_corner_diff = 20; //degree, discontinuity inside cell
+private:
+  struct node_t {
+    float shoulder;
+    float elbow;
+  };
+  float step_ = 0;
+  float inv_step_ = 0;
+  float r_min_ = 0;
+  float h_min_ = 0;
+  float d2_min_ = 0; //inner limit may cut cell between corners
+  int cols_ = 0;
+  int rows_ = 0;
+  std::vector<node_t> nodes_;
+  std::vector<uint8_t> cell_ok_;
+public:
+  //grid over R 0..reach, H -reach..reach
+  void build(float step, float reach, float reach_min, solver_t solver);
+  bool isBuilt() const {
+    return !nodes_.empty();
+  }
+  size_t getBytes() const {
+    return nodes_.size() * sizeof(node_t) + cell_ok_.size();
+  }
+  bool lookup(float R, float H, float &shoulder, float &elbow) const;
+};
+
+void ik_bench();
+#endif /* CIKTABLE_H_ */
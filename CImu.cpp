@@ -0,0 +1,385 @@
+/*
+ * CImu.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CImu.h"
+#include <math.h>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include "SparkFunMPU9250-DMP.h"
+#ifdef _SIMULATION_
+#include "CI2cSim.h"
+#else
+#include <wiringPi.h>
+#endif
+
+using namespace std;
+
+CImu imu;
+
+constexpr uint16_t CImu::compass_hz;
+
+static MPU9250_DMP mpu;
+
+#ifndef _SIMULATION_
+//wiringPiISR takes plain function
+static void imu_isr() {
+  imu.irq();
+}
+#endif
+
+static uint64_t steady_us() {
+  return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CImu::start(uint16_t rate_hz, bool use_dmp, int int_pin) {
+  if (execute_.load(std::memory_order_acquire) || (0 == rate_hz)) {
+    return false;
+  }
+  rate_hz_ = rate_hz;
+  use_dmp_ = use_dmp;
+  if ((no_int != int_pin) && (no_int == int_pin_)) { //isr is registered once per pin
+#ifndef _SIMULATION_
+    pinMode(int_pin, INPUT);
+    pullUpDnControl(int_pin, PUD_DOWN);
+    if (wiringPiISR(int_pin, INT_EDGE_RISING, imu_isr) < 0) {
+      cerr << "imu interrupt on gpio " << int_pin << " failed, polling FIFO" << endl;
+      int_pin = no_int;
+    }
+#endif
+    int_pin_ = int_pin;
+  }
+  execute_.store(true, std::memory_order_release);
+  thd_ = std::thread(&CImu::imu_function, this);
+#ifdef _SIMULATION_
+  if (no_int != int_pin_) {
+    irq_thd_ = std::thread(&CImu::sim_irq_function, this);
+  }
+#endif
+  return true;
+}
+
+void CImu::stop() {
+  if (!execute_.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
+  if (thd_.joinable()) {
+    thd_.join();
+  }
+#ifdef _SIMULATION_
+  if (irq_thd_.joinable()) {
+    irq_thd_.join();
+  }
+#endif
+}
+
+static void rotate(const float q[4], const float v[3], float out[3]) {
+  //v + 2 * q.xyz x (q.xyz x v + w * v)
+  const float t[3] = { q[2] * v[2] - q[3] * v[1] + q[0] * v[0], q[3] * v[0] - q[1] * v[2] + q[0] * v[1], q[1] * v[1]
+      - q[2] * v[0] + q[0] * v[2] };
+  out[0] = v[0] + 2 * (q[2] * t[2] - q[3] * t[1]);
+  out[1] = v[1] + 2 * (q[3] * t[0] - q[1] * t[2]);
+  out[2] = v[2] + 2 * (q[1] * t[1] - q[2] * t[0]);
+}
+
+void CImu::publish_state(const imu_sample_t &sample, uint32_t samples) {
+  constexpr float gravity = 9.807; //m/s^2
+  constexpr float q30 = 1 << 30;
+  constexpr float rad_to_deg = 180 / static_cast<float>(M_PI);
+  imu_state_t state;
+  state.time_us = sample.time_us;
+  state.samples = samples;
+  state.reserved[0] = state.reserved[1] = state.reserved[2] = 0;
+  if (ahrs_) {
+    state.source = imu_source_ahrs;
+    ahrs_->getQuaternion(state.quat);
+  } else {
+    state.source = imu_source_dmp;
+    for (auto idx = 0; idx < 4; idx++) {
+      state.quat[idx] = sample.raw.quat[idx] / q30;
+    }
+  }
+  CAhrs::quat_to_euler(state.quat, state.yaw, state.pitch, state.roll);
+  state.yaw *= rad_to_deg;
+  state.pitch *= rad_to_deg;
+  state.roll *= rad_to_deg;
+  const float accel[3] = { accel_g(sample.raw.accel[0]), accel_g(sample.raw.accel[1]), accel_g(sample.raw.accel[2]) };
+  rotate(state.quat, accel, state.linear_accel);
+  state.linear_accel[2] -= 1;
+  for (auto idx = 0; idx < 3; idx++) {
+    state.linear_accel[idx] *= gravity;
+    state.gyro[idx] = gyro_dps(sample.raw.gyro[idx]);
+  }
+  state_.write(state);
+}
+
+void CImu::publish(const imu_sample_t &chip_sample) {
+  const auto samples = samples_.fetch_add(1, std::memory_order_relaxed) + 1;
+  flight_recorder.imu(chip_sample.raw); //as read, replay calibrates again
+  imu_sample_t sample = chip_sample;
+  if (calib_) {
+    calib_->add(chip_sample.raw, chip_sample.time_us);
+    if (!use_dmp_) { //DMP removes own biases
+      calib_->correct(sample.raw);
+    }
+  }
+  if (ahrs_) {
+    //nominal period on first sample and after gaps
+    const auto dt_us = sample.time_us - ahrs_time_us_;
+    const auto dt = ((0 == ahrs_time_us_) || (dt_us > 100000)) ? 1.f / rate_hz_ : dt_us / 1e6f;
+    ahrs_time_us_ = sample.time_us;
+    ahrs_->update(sample.raw, accel_sens_, gyro_sens_, dt);
+  }
+  publish_state(sample, samples);
+}
+
+void CImu::inject(const record_imu_t &raw) {
+  publish( { steady_us(), raw });
+}
+
+bool CImu::setup() {
+  //begin leaves compass on primary bus, driver reads it from EXT_SENS_DATA filled by I2C master
+  if ((INV_SUCCESS != mpu.begin()) || (0 != mpu_set_bypass(0))) {
+    return false;
+  }
+  if (use_dmp_) {
+    //with own calibration DMP gets its biases and sends raw gyro to learn from,
+    //its no-motion calibration would fight them
+    const unsigned short gyro_features = calib_ ? DMP_FEATURE_SEND_RAW_GYRO :
+        (DMP_FEATURE_GYRO_CAL | DMP_FEATURE_SEND_CAL_GYRO);
+    if (INV_SUCCESS != mpu.dmpBegin(DMP_FEATURE_6X_LP_QUAT | DMP_FEATURE_SEND_RAW_ACCEL | gyro_features, rate_hz_)) {
+      return false;
+    }
+  } else if ((INV_SUCCESS != mpu.setSampleRate(rate_hz_)) || (INV_SUCCESS != mpu.configureFifo(INV_XYZ_GYRO
+      | INV_XYZ_ACCEL))) {
+    return false;
+  }
+  if (no_int != int_pin_) {
+    //50 us active high pulse per sample, DMP raises it per packet
+    if ((use_dmp_ && (INV_SUCCESS != mpu.dmpSetInterruptMode(DMP_INT_CONTINUOUS)))
+        || (INV_SUCCESS != mpu.setIntLevel(0)) || (INV_SUCCESS != mpu.setIntLatched(0))
+        || (INV_SUCCESS != mpu.enableInterrupt(1))) {
+      return false;
+    }
+  }
+  if (INV_SUCCESS != mpu.setCompassSampleRate(min(rate_hz_, compass_hz))) {
+    return false;
+  }
+  accel_sens_ = mpu.getAccelSens();
+  gyro_sens_ = mpu.getGyroSens();
+  if (calib_) {
+    calib_->setup(rate_hz_, accel_sens_, gyro_sens_);
+    if (use_dmp_ && calib_->isCalibrated() && !push_dmp_bias()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CImu::push_dmp_bias() {
+  calib_->takeChanged();
+  long gyro[3];
+  long accel[3];
+  calib_->getDmpBias(gyro, accel);
+  return (INV_SUCCESS == mpu.dmpSetGyroBias(gyro)) && (INV_SUCCESS == mpu.dmpSetAccelBias(accel));
+}
+
+void CImu::wait_data(uint32_t period_us) {
+  if (no_int == int_pin_) {
+    return;
+  }
+  //missed edge costs a few periods, not a stall; wall clock steps do not move the deadline
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 30)
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  const auto timeout_ns = deadline.tv_nsec + 4ull * period_us * 1000;
+  deadline.tv_sec += timeout_ns / 1000000000;
+  deadline.tv_nsec = timeout_ns % 1000000000;
+  sem_clockwait(&irq_, CLOCK_MONOTONIC, &deadline);
+#else
+  const auto deadline = chrono::steady_clock::now() + chrono::microseconds(4 * period_us);
+  while ((0 != sem_trywait(&irq_)) && (chrono::steady_clock::now() < deadline)) {
+    this_thread::sleep_for(chrono::microseconds(max(100u, period_us / 8)));
+  }
+#endif
+  while (0 == sem_trywait(&irq_)) { //FIFO is drained as a whole
+  }
+}
+
+#ifdef _SIMULATION_
+void CImu::sim_irq_function() {
+  const auto period = chrono::microseconds(1000000 / rate_hz_);
+  auto next = chrono::steady_clock::now();
+  while (execute_.load(std::memory_order_acquire)) {
+    next += period;
+    this_thread::sleep_until(next);
+    irq();
+  }
+}
+#endif
+
+void CImu::imu_function() {
+  const auto period_us = 1000000 / rate_hz_;
+  while (execute_.load(std::memory_order_acquire) && !setup()) {
+    cerr << "Unable to communicate with MPU-9250, check connections" << endl;
+    for (auto wait = 0; execute_.load(std::memory_order_acquire) && (wait < 50); wait++) {
+      this_thread::sleep_for(chrono::milliseconds(100));
+    }
+  }
+  ready_.store(true, std::memory_order_release);
+  //whole FIFO in one pass: count once, packets in block reads
+  unsigned char fifo[fifo_bytes];
+  const uint64_t compass_period_us = 1000000 / min(rate_hz_, compass_hz);
+  uint64_t compass_us = 0;
+  while (execute_.load(std::memory_order_acquire)) {
+    wait_data(period_us);
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    unsigned short packets = 0;
+    const auto packet_bytes = mpu.fifoPacketSize();
+    if ((0 == packet_bytes) || (INV_SUCCESS != mpu.readFifoBurst(fifo, fifo_bytes / packet_bytes, &packets))) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (0 == packets) {
+      if (no_int == int_pin_) {
+        this_thread::sleep_for(chrono::microseconds(period_us / 2));
+      }
+      continue;
+    }
+    //samples were taken one period apart, last one just now
+    const auto read_us = steady_us();
+    //compass is not in FIFO, latest reading goes with each sample
+    if (read_us - compass_us >= compass_period_us) {
+      compass_us = read_us;
+      if (INV_SUCCESS != mpu.updateCompass()) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    for (auto idx = 0; idx < packets; idx++) {
+      if (!mpu.decodeFifo(fifo + idx * packet_bytes)) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        mpu.resetFifo();
+        break;
+      }
+      const imu_sample_t sample { read_us - static_cast<uint64_t>(packets - 1 - idx) * period_us, { {
+          static_cast<int16_t>(mpu.ax), static_cast<int16_t>(mpu.ay), static_cast<int16_t>(mpu.az) }, {
+          static_cast<int16_t>(mpu.gx), static_cast<int16_t>(mpu.gy), static_cast<int16_t>(mpu.gz) }, {
+          static_cast<int16_t>(mpu.mx), static_cast<int16_t>(mpu.my), static_cast<int16_t>(mpu.mz) }, 0, {
+          static_cast<int32_t>(mpu.qw), static_cast<int32_t>(mpu.qx), static_cast<int32_t>(mpu.qy),
+          static_cast<int32_t>(mpu.qz) } } };
+      publish(sample);
+    }
+    //online tracking moved biases while robot stands
+    if (use_dmp_ && calib_ && calib_->takeChanged() && !push_dmp_bias()) {
+      errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  ready_.store(false, std::memory_order_release);
+}
+
+void imu_fifo_bench() {
+#ifndef _SIMULATION_
+  cout << "imu fifo bench runs on simulated bus, build with SIMULATION=1" << endl;
+  return;
+#else
+  auto &chip = sim_mpu9250(1, CSimMpu9250::ADDRESS);
+  auto &bus = i2c_bus(1);
+  chip.setManualClock(true); //1 s of chip time per run, bench is not paced by sleeps
+  enum method_t {
+    legacy, burst
+  };
+  //reader polls FIFO every poll_us, chip adds packet every period
+  const auto run = [&chip, &bus](uint16_t rate_hz, uint32_t poll_us, method_t method, bool dmp) {
+    //same configuration as CImu::setup
+    if ((INV_SUCCESS != mpu.begin()) || (0 != mpu_set_bypass(0)) || (dmp ?
+        (INV_SUCCESS != mpu.dmpBegin(DMP_FEATURE_6X_LP_QUAT | DMP_FEATURE_GYRO_CAL | DMP_FEATURE_SEND_RAW_ACCEL
+            | DMP_FEATURE_SEND_CAL_GYRO, rate_hz)) :
+        ((INV_SUCCESS != mpu.setSampleRate(rate_hz)) || (INV_SUCCESS != mpu.configureFifo(INV_XYZ_GYRO | INV_XYZ_ACCEL))))) {
+      cout << " simulated MPU-9250 setup failed" << endl;
+      return;
+    }
+    unsigned char fifo[CImu::fifo_bytes];
+    const auto packet_bytes = mpu.fifoPacketSize();
+    const auto produced = chip.getSamples();
+    const auto overflows = chip.getOverflows();
+    uint32_t samples = 0;
+    mpu.resetFifo();
+    bus.getProfile().reset();
+    for (uint32_t t_us = poll_us; t_us <= 1000000; t_us += poll_us) {
+      chip.advance(poll_us);
+      if (legacy == method) {
+        //previous loop: count in two register reads, then packet by packet
+        const auto pending = mpu.fifoAvailable() / packet_bytes;
+        for (auto idx = 0; idx < pending; idx++) {
+          if (INV_SUCCESS != mpu.updateFifo()) {
+            break;
+          }
+          samples++;
+        }
+      } else {
+        unsigned short packets = 0;
+        mpu.readFifoBurst(fifo, CImu::fifo_bytes / packet_bytes, &packets);
+        for (auto idx = 0; idx < packets; idx++) {
+          mpu.decodeFifo(fifo + idx * packet_bytes);
+        }
+        samples += packets;
+      }
+    }
+    const auto &counters = bus.getProfile().getDevice(CSimMpu9250::ADDRESS);
+    const auto transfers = counters.getTransfers();
+    const auto wire_ns = counters.wire_ns.load();
+    cout << " " << ((legacy == method) ? "legacy" : "burst ") << " packet=" << packet_bytes << " samples=" << samples
+        << "/" << chip.getSamples() - produced << " overflows=" << chip.getOverflows() - overflows
+        << " transfers/sample=" << static_cast<float>(transfers) / max<uint32_t>(samples, 1) << " bus/sample="
+        << wire_ns / max<uint32_t>(samples, 1) / 1000.0f << "us bus load=" << wire_ns / 10000000.0f << "%" << endl;
+  };
+  for (const uint16_t rate_hz : { 100, 200, 500, 1000 }) {
+    //previous loop polled every half period, consumer thread at 100 Hz polls every 10 ms
+    for (const uint32_t poll_us : { 500000u / rate_hz, 10000u }) {
+      cout << "imu fifo rate=" << rate_hz << "Hz poll=" << poll_us << "us" << endl;
+      run(rate_hz, poll_us, legacy, false);
+      run(rate_hz, poll_us, burst, false);
+      if (rate_hz <= 200) { //DMP output rate limit
+        run(rate_hz, poll_us, burst, true); //quaternion, accel, gyro
+      }
+    }
+  }
+  chip.setManualClock(false);
+#endif
+}
+
+void imu_state_bench() {
+  //reader cost while imu thread publishes at 1 kHz and, worst case, back to back
+  constexpr auto reads = 10000000;
+  for (const uint32_t period_us : { 1000u, 0u }) {
+    CSeqlock<imu_state_t> seqlock;
+    atomic<bool> run { true };
+    thread writer([&seqlock, &run, period_us]() {
+      imu_state_t state { };
+      while (run.load(std::memory_order_relaxed)) {
+        state.samples++;
+        state.time_us = state.samples;
+        seqlock.write(state);
+        if (period_us) {
+          this_thread::sleep_for(chrono::microseconds(period_us));
+        }
+      }
+    });
+    this_thread::sleep_for(chrono::milliseconds(10));
+    imu_state_t state;
+    uint32_t torn = 0;
+    const auto started = chrono::steady_clock::now();
+    for (auto idx = 0; idx < reads; idx++) {
+      seqlock.read(state);
+      torn += state.samples != state.time_us;
+    }
+    const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    run.store(false);
+    writer.join();
+    cout << "imu state writer period=" << period_us << "us reads=" << reads << " " << static_cast<float>(ns) / reads
+        << "ns/read retries=" << seqlock.getRetries() << " torn=" << torn << endl;
+  }
+}
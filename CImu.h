@@ -0,0 +1,159 @@
+/*
+ * CImu.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CIMU_H_
+#define CIMU_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <thread>
+#include <semaphore.h>
+#include "CSeqlock.h"
+#include "CFlightRecorder.h"
+#include "CAhrs.h"
+#include "CImuCalib.h"
+
+struct imu_sample_t {
+  uint64_t time_us; //steady clock, when sample was taken
+  record_imu_t raw;
+};
+
+//latest orientation, published on each sample
+struct imu_state_t {
+  uint64_t time_us; //sample time
+  uint32_t samples;
+  uint8_t source; //imu_source_t
+  uint8_t reserved[3];
+  float quat[4]; //w x y z
+  float yaw; //deg
+  float pitch;
+  float roll;
+  float linear_accel[3]; //m/s^2, earth frame, gravity removed
+  float gyro[3]; //dps, sensor frame
+};
+
+enum imu_source_t : uint8_t {
+  imu_source_dmp = 0, //DMP quaternion, 6 axis
+  imu_source_ahrs //9 axis filter
+};
+
+/***
+ * MPU-9250 acquisition thread: drains chip FIFO, each timestamped sample goes to
+ * flight recorder, calibration and filter in this thread, result is published as state.
+ * With INT pin wired thread sleeps until data ready edge, otherwise FIFO is polled.
+ * Simulation runs same driver against MPU-9250 model on simulated bus,
+ * software interrupt source stands for INT pin.
+ */
+class CImu {
+public:
+  static constexpr size_t fifo_bytes = 512; //chip FIFO size
+  static constexpr int no_int = -1;
+  static constexpr uint16_t compass_hz = 100; //AK8963 continuous mode 2
+private:
+  uint16_t rate_hz_ = 100;
+  bool use_dmp_ = false;
+  int int_pin_ = no_int;
+  sem_t irq_;
+  float accel_sens_ = 16384; //LSB/g
+  float gyro_sens_ = 16.4f; //LSB/dps
+  std::atomic<bool> execute_ { false };
+  std::atomic<bool> ready_ { false };
+  std::thread thd_;
+  std::atomic<uint32_t> samples_ { 0 };
+  std::atomic<uint32_t> errors_ { 0 };
+  std::atomic<uint32_t> irqs_ { 0 };
+  std::atomic<uint32_t> wakeups_ { 0 };
+  CAhrs *ahrs_ = nullptr;
+  CImuCalib *calib_ = nullptr;
+  uint64_t ahrs_time_us_ = 0;
+  CSeqlock<imu_state_t> state_;
+#ifdef _SIMULATION_
+  std::thread irq_thd_;
+  void sim_irq_function();
+#endif
+  bool setup();
+  bool push_dmp_bias();
+  void wait_data(uint32_t period_us);
+  void publish(const imu_sample_t &chip_sample);
+  void publish_state(const imu_sample_t &sample, uint32_t samples);
+  void imu_function();
+public:
+  CImu() {
+    sem_init(&irq_, 0, 0);
+  }
+  ~CImu() {
+    stop();
+    sem_destroy(&irq_);
+  }
+  //filter runs on every sample in publishing thread, set before start
+  void attach(CAhrs &ahrs) {
+    ahrs_ = &ahrs;
+  }
+  //biases are learned from uncorrected samples and removed before filter and consumers
+  void attach(CImuCalib &calib) {
+    calib_ = &calib;
+  }
+  //use_dmp: quaternion from DMP FIFO, otherwise raw accel and gyro
+  //int_pin: gpio wired to MPU-9250 INT, no_int - poll FIFO
+  bool start(uint16_t rate_hz, bool use_dmp, int int_pin = no_int);
+  void stop();
+  //replay, thread is not started: sample as if read from chip
+  void inject(const record_imu_t &raw);
+  //data ready edge, called from isr
+  void irq() {
+    irqs_.fetch_add(1, std::memory_order_relaxed);
+    sem_post(&irq_);
+  }
+  //lock free, never blocks acquisition; false - no sample yet
+  bool getState(imu_state_t &state) const {
+    return state_.read(state) && (0 != state.samples);
+  }
+  uint32_t getStateRetries() const {
+    return state_.getRetries();
+  }
+  bool isReady() const {
+    return ready_.load(std::memory_order_acquire);
+  }
+  uint16_t getRate() const {
+    return rate_hz_;
+  }
+  float accel_g(int16_t raw) const {
+    return raw / accel_sens_;
+  }
+  float gyro_dps(int16_t raw) const {
+    return raw / gyro_sens_;
+  }
+  float getAccelSens() const {
+    return accel_sens_;
+  }
+  float getGyroSens() const {
+    return gyro_sens_;
+  }
+  uint32_t getSamples() const {
+    return samples_.load(std::memory_order_relaxed);
+  }
+  uint32_t getErrors() const {
+    return errors_.load(std::memory_order_relaxed);
+  }
+  int getIntPin() const {
+    return int_pin_;
+  }
+  uint32_t getIrqs() const {
+    return irqs_.load(std::memory_order_relaxed);
+  }
+  //FIFO reads
+  uint32_t getWakeups() const {
+    return wakeups_.load(std::memory_order_relaxed);
+  }
+};
+
+extern CImu imu;
+
+void imu_fifo_bench();
+void imu_state_bench();
+
+#endif /* CIMU_H_ */
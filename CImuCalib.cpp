@@ -0,0 +1,221 @@
+/*
+ * CImuCalib.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CImuCalib.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+CImuCalib imu_calib;
+
+constexpr float CImuCalib::window_s;
+constexpr float CImuCalib::still_gyro_std;
+constexpr float CImuCalib::still_accel_std;
+constexpr float CImuCalib::max_gyro_bias;
+constexpr float CImuCalib::max_accel_bias;
+constexpr float CImuCalib::track_gain;
+constexpr uint32_t CImuCalib::save_period_s;
+
+static const char calib_magic[4] = { 'R', 'C', 'I', 'C' };
+static constexpr uint16_t calib_version = 1;
+
+static int16_t saturate(float value) {
+  return static_cast<int16_t>(fmaxf(INT16_MIN, fminf(INT16_MAX, roundf(value))));
+}
+
+CImuCalib::CImuCalib() {
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro_bias_[axis].store(0, std::memory_order_relaxed);
+    accel_bias_[axis].store(0, std::memory_order_relaxed);
+  }
+}
+
+bool CImuCalib::load(const string &file) {
+  file_ = file;
+  ifstream is(file, ios::binary);
+  file_t stored;
+  if (!is || !is.read(reinterpret_cast<char*>(&stored), sizeof(stored))) {
+    return false;
+  }
+  if (memcmp(stored.magic, calib_magic, sizeof(calib_magic)) || (calib_version != stored.version)) {
+    return false;
+  }
+  for (auto axis = 0; axis < 3; axis++) {
+    if (!(fabsf(stored.gyro_bias[axis]) <= max_gyro_bias) || !(fabsf(stored.accel_bias[axis]) <= max_accel_bias)) {
+      return false;
+    }
+  }
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro_bias_[axis].store(stored.gyro_bias[axis], std::memory_order_relaxed);
+    accel_bias_[axis].store(stored.accel_bias[axis], std::memory_order_relaxed);
+  }
+  windows_.store(max<uint32_t>(stored.windows, 1), std::memory_order_relaxed);
+  changed_ = true;
+  return true;
+}
+
+bool CImuCalib::save() const {
+  if ("" == file_) {
+    return false;
+  }
+  file_t stored;
+  memcpy(stored.magic, calib_magic, sizeof(calib_magic));
+  stored.version = calib_version;
+  stored.reserved = 0;
+  for (auto axis = 0; axis < 3; axis++) {
+    stored.gyro_bias[axis] = getGyroBias(axis);
+    stored.accel_bias[axis] = getAccelBias(axis);
+  }
+  stored.windows = getWindows();
+  //write aside and rename, reader never sees half file
+  const auto tmp = file_ + ".tmp";
+  {
+    ofstream os(tmp, ios::binary | ios::trunc);
+    os.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+    if (!os) {
+      return false;
+    }
+  }
+  return 0 == rename(tmp.c_str(), file_.c_str());
+}
+
+void CImuCalib::setup(uint16_t rate_hz, float accel_sens, float gyro_sens) {
+  window_samples_ = max<uint32_t>(static_cast<uint32_t>(rate_hz * window_s), 2);
+  accel_sens_ = accel_sens;
+  gyro_sens_ = gyro_sens;
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro_[axis].reset();
+    accel_[axis].reset();
+  }
+}
+
+void CImuCalib::add(const record_imu_t &raw, uint64_t time_us) {
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro_[axis].add(raw.gyro[axis] / gyro_sens_);
+    accel_[axis].add(raw.accel[axis] / accel_sens_);
+  }
+  if (gyro_[0].n >= window_samples_) {
+    window_done(time_us);
+  }
+}
+
+void CImuCalib::window_done(uint64_t time_us) {
+  //level: gravity along +z
+  bool still = true;
+  float gyro_bias[3];
+  float accel_bias[3];
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro_bias[axis] = gyro_[axis].mean;
+    accel_bias[axis] = accel_[axis].mean - ((2 == axis) ? 1 : 0);
+    still = still && (sqrt(gyro_[axis].variance()) < still_gyro_std)
+        && (sqrt(accel_[axis].variance()) < still_accel_std) && (fabsf(gyro_bias[axis]) < max_gyro_bias)
+        && (fabsf(accel_bias[axis]) < max_accel_bias);
+    gyro_[axis].reset();
+    accel_[axis].reset();
+  }
+  still_.store(still, std::memory_order_relaxed);
+  if (!still) {
+    moving_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  //first window sets biases, then slow drift is tracked
+  const auto windows = windows_.load(std::memory_order_relaxed);
+  const auto gain = windows ? track_gain : 1;
+  for (auto axis = 0; axis < 3; axis++) {
+    const auto gyro = getGyroBias(axis);
+    const auto accel = getAccelBias(axis);
+    gyro_bias_[axis].store(gyro + gain * (gyro_bias[axis] - gyro), std::memory_order_relaxed);
+    accel_bias_[axis].store(accel + gain * (accel_bias[axis] - accel), std::memory_order_relaxed);
+  }
+  windows_.store(windows + 1, std::memory_order_relaxed);
+  changed_ = true;
+  if ((0 == windows) || (time_us - saved_us_ >= save_period_s * 1000000ull)) {
+    saved_us_ = time_us;
+    save_pending_.store("" != file_, std::memory_order_release);
+  }
+}
+
+void CImuCalib::service() {
+  if (save_pending_.exchange(false, std::memory_order_acq_rel) && !save()) {
+    cerr << "imu calibration save failed " << file_ << endl;
+  }
+}
+
+void CImuCalib::correct(record_imu_t &raw) const {
+  for (auto axis = 0; axis < 3; axis++) {
+    raw.gyro[axis] = saturate(raw.gyro[axis] - getGyroBias(axis) * gyro_sens_);
+    raw.accel[axis] = saturate(raw.accel[axis] - getAccelBias(axis) * accel_sens_);
+  }
+}
+
+void CImuCalib::getDmpBias(long gyro[3], long accel[3]) const {
+  constexpr float q16 = 1 << 16;
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro[axis] = lroundf(getGyroBias(axis) * q16);
+    accel[axis] = lroundf(getAccelBias(axis) * q16);
+  }
+}
+
+void imu_calib_bench() {
+  //100 Hz, chip offsets as typical MPU-9250 part, sensor noise about datasheet level
+  constexpr uint16_t rate_hz = 100;
+  const float gyro_bias[3] = { 1.2f, -0.8f, 0.4f };
+  const float accel_bias[3] = { 0.02f, -0.03f, 0.05f };
+  uint32_t seed = 1;
+  const auto noise = [&seed](float amplitude) {
+    seed = seed * 1103515245 + 12345;
+    return amplitude * (static_cast<float>((seed >> 8) & 0xFFFF) / 0x8000 - 1);
+  };
+  const auto sample = [&](float yaw_rate, float drift) {
+    record_imu_t raw { };
+    for (auto axis = 0; axis < 3; axis++) {
+      raw.gyro[axis] = saturate((gyro_bias[axis] + drift + ((2 == axis) ? yaw_rate : 0) + noise(0.3f)) * 16.4f);
+      raw.accel[axis] = saturate((accel_bias[axis] + ((2 == axis) ? 1 : 0) + noise(0.01f)) * 16384);
+    }
+    return raw;
+  };
+  const auto report = [&](const char *phase, const CImuCalib &calib, float drift) {
+    float gyro_err = 0;
+    float accel_err = 0;
+    for (auto axis = 0; axis < 3; axis++) {
+      gyro_err = max(gyro_err, fabsf(calib.getGyroBias(axis) - gyro_bias[axis] - drift));
+      accel_err = max(accel_err, fabsf(calib.getAccelBias(axis) - accel_bias[axis]));
+    }
+    cout << "imu calib " << phase << " windows=" << calib.getWindows() << " moving=" << calib.getMoving()
+        << " gyro err=" << gyro_err << "dps accel err=" << accel_err * 1000 << "mg" << endl;
+  };
+  CImuCalib calib;
+  calib.setup(rate_hz, 16384, 16.4f);
+  uint64_t time_us = 0;
+  //robot turns, no window may be taken for still
+  for (auto idx = 0; idx < 10 * rate_hz; idx++, time_us += 10000) {
+    calib.add(sample(20 * sinf(idx * 0.01f), 0), time_us);
+  }
+  report("turning 10s", calib, 0);
+  size_t samples = 0;
+  while (!calib.isCalibrated() && (samples < 60u * rate_hz)) {
+    calib.add(sample(0, 0), time_us);
+    samples++;
+    time_us += 10000;
+  }
+  cout << "imu calib first estimate after " << samples * 1000 / rate_hz << "ms" << endl;
+  report("still", calib, 0);
+  //gyro offset drifts with temperature while robot stands
+  constexpr float drift = 0.5f;
+  for (auto idx = 0; idx < 60 * rate_hz; idx++, time_us += 10000) {
+    calib.add(sample(0, drift), time_us);
+  }
+  report("drift 0.5dps 60s", calib, drift);
+  cout << "imu calib previous method: rounds of 1000 samples until deadzone, " << 1000 / rate_hz
+      << "s per round at " << rate_hz << "Hz" << endl;
+}
@@ -0,0 +1,120 @@
+/*
+ * CImuCalib.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CIMUCALIB_H_
+#define CIMUCALIB_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <atomic>
+#include "CFlightRecorder.h"
+
+//running mean and variance, one pass
+struct welford_t {
+  uint32_t n = 0;
+  double mean = 0;
+  double m2 = 0;
+  void add(double x) {
+    n++;
+    const auto delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+  }
+  double variance() const {
+    return (1 < n) ? m2 / (n - 1) : 0;
+  }
+  void reset() {
+    n = 0;
+    mean = 0;
+    m2 = 0;
+  }
+};
+
+/***
+ * gyro and accel bias from windows where robot stands still and level.
+ * Window is still when gyro and accel noise is low and readings are close to zero rate and 1 g.
+ * First still window sets biases, later ones track slow drift. Biases are kept in file
+ * and loaded on start, so imu is calibrated from first sample.
+ * Fed by imu thread, biases can be read by any. File is written by service() off imu thread.
+ */
+class CImuCalib {
+public:
+  struct file_t {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    float gyro_bias[3]; //dps
+    float accel_bias[3]; //g
+    uint32_t windows; //still windows averaged
+  };
+  static constexpr float window_s = 1;
+  static constexpr float still_gyro_std = 0.5f; //dps
+  static constexpr float still_accel_std = 0.02f; //g
+  static constexpr float max_gyro_bias = 5; //dps, chip zero rate offset limit
+  static constexpr float max_accel_bias = 0.15f; //g
+  static constexpr float track_gain = 0.1f; //per window after first
+  static constexpr uint32_t save_period_s = 600;
+private:
+  std::string file_;
+  welford_t gyro_[3];
+  welford_t accel_[3];
+  uint32_t window_samples_ = 100;
+  float accel_sens_ = 16384;
+  float gyro_sens_ = 16.4f;
+  std::atomic<float> gyro_bias_[3];
+  std::atomic<float> accel_bias_[3];
+  std::atomic<uint32_t> windows_ { 0 };
+  std::atomic<uint32_t> moving_ { 0 };
+  std::atomic<bool> still_ { false };
+  bool changed_ = false;
+  uint64_t saved_us_ = 0;
+  std::atomic<bool> save_pending_ { false };
+  void window_done(uint64_t time_us);
+public:
+  CImuCalib();
+  //file: "" - not persisted
+  bool load(const std::string &file);
+  bool save() const;
+  //writes file if imu thread asked for it, called periodically by main loop
+  void service();
+  void setup(uint16_t rate_hz, float accel_sens, float gyro_sens);
+  //uncorrected sample
+  void add(const record_imu_t &raw, uint64_t time_us);
+  //subtracts biases in place
+  void correct(record_imu_t &raw) const;
+  //biases changed since previous call, to push them to DMP
+  bool takeChanged() {
+    const auto changed = changed_;
+    changed_ = false;
+    return changed;
+  }
+  //q16 dps and g, as dmpSetGyroBias and dmpSetAccelBias take
+  void getDmpBias(long gyro[3], long accel[3]) const;
+  float getGyroBias(size_t axis) const {
+    return gyro_bias_[axis].load(std::memory_order_relaxed);
+  }
+  float getAccelBias(size_t axis) const {
+    return accel_bias_[axis].load(std::memory_order_relaxed);
+  }
+  uint32_t getWindows() const {
+    return windows_.load(std::memory_order_relaxed);
+  }
+  uint32_t getMoving() const {
+    return moving_.load(std::memory_order_relaxed);
+  }
+  bool isStill() const {
+    return still_.load(std::memory_order_relaxed);
+  }
+  bool isCalibrated() const {
+    return 0 != getWindows();
+  }
+};
+
+extern CImuCalib imu_calib;
+
+void imu_calib_bench();
+#endif /* CIMUCALIB_H_ */
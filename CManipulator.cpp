@@ -6,8 +6,11 @@
  */
 
 #include "CManipulator.h"
+#include "CPwmRegistry.h"
 #include <iostream>
 #include <math.h>
+#include <chrono>
+#include <algorithm>
 using namespace std;
 CManipulator::CManipulator(uint8_t pin_base, uint8_t pin_shoulder, uint8_t pin_elbow) :
     servo_base(pin_base, 0, 180), servo_shoulder(pin_shoulder, 0, 180), servo_elbow(pin_elbow, 0, 180) {
@@ -61,21 +64,157 @@ int CManipulator::InverseKinematicsTransform(double R, double H, double &Shoulde
 //  return 0;
 //}
 void CManipulator::init() {
+  if (0 < ik_table_step_) {
+    ik_table_.build(ik_table_step_, d_Max, d_Min, InverseKinematicsTransform);
+  }
+  for (auto servo : { &servo_base, &servo_shoulder, &servo_elbow }) {
+    servo->setProfile(joint_speed, joint_acceleration, joint_jerk);
+  }
   servo_base.init();
   servo_shoulder.init();
   servo_elbow.init();
 }
 void CManipulator::set_bse(int16_t base, int16_t shoulder, int16_t elbow) {
   cout << "CManipulator=" << base << " " << shoulder << " " << elbow << endl;
+  write_bse(base, shoulder, elbow);
+}
+
+void CManipulator::write_bse(int16_t base, int16_t shoulder, int16_t elbow) {
+  CPwmRegistry::Batch batch(pwm_registry);
   servo_base.setVal(base);
   servo_shoulder.setVal(shoulder);
   servo_elbow.setVal(elbow);
 }
 
+bool CManipulator::solve(float R, float H, double &Shoulder, double &Elbow) const {
+  float shoulder_f;
+  float elbow_f;
+  if (ik_table_.lookup(R, H, shoulder_f, elbow_f)) {
+    Shoulder = shoulder_f;
+    Elbow = elbow_f;
+    return true;
+  }
+  return 0 == InverseKinematicsTransform(R, H, Shoulder, Elbow); //table edge or out of reach
+}
+
 void CManipulator::set_xyz(int16_t _x, int16_t _y, int16_t _z) {
   double Shoulder;
   double Elbow;
-  if (0 == InverseKinematicsTransform(_x, _y, Shoulder, Elbow)) {
-    set_bse(_z, 180 - static_cast<int16_t>(Shoulder), static_cast<int16_t>(Elbow) - static_cast<int16_t>(Shoulder));
+  if (!solve(_x, _y, Shoulder, Elbow)) {
+    return;
+  }
+  set_bse(_z, 180 - static_cast<int16_t>(Shoulder), static_cast<int16_t>(Elbow) - static_cast<int16_t>(Shoulder));
+}
+
+bool CManipulator::plan(float x, float y, float z, int16_t &base, int16_t &shoulder, int16_t &elbow) const {
+  if (0 > y) { //base turns 0..180
+    return false;
+  }
+  double Shoulder;
+  double Elbow;
+  if (!solve(sqrtf(x * x + y * y), z, Shoulder, Elbow)) {
+    return false;
+  }
+  base = static_cast<int16_t>(lrint(atan2(y, x) * 180 / M_PI));
+  shoulder = 180 - static_cast<int16_t>(Shoulder);
+  elbow = static_cast<int16_t>(Elbow) - static_cast<int16_t>(Shoulder);
+  return true;
+}
+
+bool CManipulator::start_path(const vector<waypoint_t> &points, uint32_t blend_ms) {
+  int16_t base;
+  int16_t shoulder;
+  int16_t elbow;
+  for (const auto &point : points) {
+    if (!plan(point.x, point.y, point.z, base, shoulder, elbow)) {
+      return false;
+    }
+  }
+  CArmPath path;
+  if (!path.set(points, blend_ms)) {
+    return false;
+  }
+  lock_guard<mutex> guard(path_mu_);
+  path_ = path;
+  progress_ = { path_running, 0, path_.getDuration(), 0, path_.getCount() - 1, 0 };
+  return true;
+}
+
+void CManipulator::cancel_path() {
+  lock_guard<mutex> guard(path_mu_);
+  if (path_running == progress_.state) {
+    progress_.state = path_cancelled; //servos stop at last target
+  }
+}
+
+path_progress_t CManipulator::getProgress() const {
+  lock_guard<mutex> guard(path_mu_);
+  return progress_;
+}
+
+void CManipulator::step(float dt) {
+  lock_guard<mutex> guard(path_mu_);
+  if (path_running != progress_.state) {
+    return;
+  }
+  progress_.elapsed = min(progress_.elapsed + dt, progress_.duration);
+  progress_.segment = path_.segment(progress_.elapsed);
+  float x;
+  float y;
+  float z;
+  path_.sample(progress_.elapsed, x, y, z);
+  int16_t base;
+  int16_t shoulder;
+  int16_t elbow;
+  if (plan(x, y, z, base, shoulder, elbow)) {
+    write_bse(base, shoulder, elbow);
+  } else {
+    progress_.unreachable++;
+  }
+  if (progress_.elapsed >= progress_.duration) {
+    progress_.state = path_done;
+  }
+}
+
+void arm_path_bench() {
+  //per tick planning cost: path sample + IK, analytic and table
+  CManipulator arm(4, 6, 5);
+  const vector<waypoint_t> points = {
+    { 100, 20, 30, 0 }, { 60, 90, 60, 1000 }, { -40, 100, 20, 2000 }, { -90, 40, 40, 3000 }, { 100, 20, 30, 5000 }
+  };
+  constexpr auto rate_hz = 50;
+  constexpr auto dt = 1.f / rate_hz;
+  for (const auto step : { 0.f, 2.f }) {
+    arm.useIkTable(step);
+    if (0 < step) {
+      arm.ik_table_.build(step, CManipulator::d_Max, CManipulator::d_Min, CManipulator::InverseKinematicsTransform);
+    }
+    CArmPath path;
+    path.set(points, 200);
+    constexpr auto loops = 2000;
+    uint32_t ticks = 0;
+    uint32_t unreachable = 0;
+    volatile int16_t sink = 0;
+    const auto started = chrono::steady_clock::now();
+    for (auto loop = 0; loop < loops; loop++) {
+      for (float t = 0; t <= path.getDuration(); t += dt) {
+        float x;
+        float y;
+        float z;
+        int16_t base;
+        int16_t shoulder;
+        int16_t elbow;
+        path.sample(t, x, y, z);
+        if (arm.plan(x, y, z, base, shoulder, elbow)) {
+          sink = sink + base + shoulder + elbow;
+        } else {
+          unreachable++;
+        }
+        ticks++;
+      }
+    }
+    const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    cout << "arm path " << ((0 < step) ? "ik table" : "analytic") << " per tick=" << ns / ticks << "ns ticks="
+        << ticks / loops << " unreachable=" << unreachable / loops << endl;
   }
 }
@@ -9,25 +9,72 @@
 #ifndef CMANIPULATOR_H_
 #define CMANIPULATOR_H_
 #include <stdint.h>
+#include <mutex>
 #include "pca9685Servo.h"
+#include "CIkTable.h"
+#include "CArmPath.h"
+
+enum path_state_t {
+  path_idle,
+  path_running,
+  path_done,
+  path_cancelled
+};
+
+struct path_progress_t {
+  path_state_t state;
+  float elapsed; //s
+  float duration;
+  size_t segment;
+  size_t segments;
+  uint32_t unreachable; //ticks skipped, target out of workspace
+};
 
 class CManipulator {
   pca9685_Servo servo_base;
   pca9685_Servo servo_shoulder;
   pca9685_Servo servo_elbow;
-
-  int InverseKinematicsTransform(double R, double H, double &Shoulder, double &Elbow);
+  CIkTable ik_table_;
+  float ik_table_step_ = 0; //0 - analytic only
+  //path execution, stepped by actuator tick
+  mutable std::mutex path_mu_;
+  CArmPath path_;
+  path_progress_t progress_ { path_idle, 0, 0, 0, 0, 0 };
+  void write_bse(int16_t base, int16_t shoulder, int16_t elbow);
 public:
   static constexpr auto BackArm_mm = 80;
   static constexpr auto ForeArm_mm = 80;
   static constexpr auto d_Min = 15;
   static constexpr auto d_Max = 155;
   static constexpr auto R_offset_mm = 7.5; // length in MM, that the Left and Right servo place outward than rotation centre
+  //joint motion limits, smooth start and stop keeps 5V rail up
+  static constexpr auto joint_speed = 120; // degree/s
+  static constexpr auto joint_acceleration = 480; // degree/s^2
+  static constexpr auto joint_jerk = 4800; // degree/s^3
   CManipulator(uint8_t pin_base, uint8_t pin_shoulder, uint8_t pin_elbow);
+  //ret 0 - ok, 1 - out of range, 2 - too close; angles in degree
+  static int InverseKinematicsTransform(double R, double H, double &Shoulder, double &Elbow);
+  //table is built in init, grid step mm
+  void useIkTable(float step) {
+    ik_table_step_ = step;
+  }
+  float getIkTableStep() const {
+    return ik_table_step_;
+  }
   void init();
   void set_bse(int16_t base, int16_t shoulder, int16_t elbow);
   void set_xyz(int16_t _x, int16_t _y, int16_t _z);
+  bool solve(float R, float H, double &Shoulder, double &Elbow) const;
+  //cartesian point to joint angles: base from x,y (y >= 0), R in xy plane, H = z
+  bool plan(float x, float y, float z, int16_t &base, int16_t &shoulder, int16_t &elbow) const;
+  //replaces running path, all waypoints must be reachable
+  bool start_path(const std::vector<waypoint_t> &points, uint32_t blend_ms);
+  void cancel_path();
+  path_progress_t getProgress() const;
+  void step(float dt);
+  friend void arm_path_bench();
   //void set_relative(int16_t _dx, int16_t _dy, int16_t _dz);
 };
 
+void arm_path_bench();
 #endif /* CMANIPULATOR_H_ */
@@ -0,0 +1,191 @@
+/*
+ * CMotorController.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CMotorController.h"
+#include "CActuatorTick.h"
+#include "CFlightRecorder.h"
+#include "CPwmRegistry.h"
+#include <math.h>
+#include <iostream>
+
+using namespace std;
+
+//wiringPiISR takes plain function, so edge handlers are dispatched by slot
+static CWheelEncoder *encoder_slots[CMotorController::max_motors];
+template<size_t I>
+static void edge_trampoline() {
+  if (encoder_slots[I]) {
+    encoder_slots[I]->edge_handler();
+  }
+}
+static void (*const edge_handlers[CMotorController::max_motors])(void) = {
+  edge_trampoline<0>, edge_trampoline<1>, edge_trampoline<2>, edge_trampoline<3>
+};
+
+constexpr uint32_t CMotorController::vbat_period_ms;
+
+static float clamp(float val, float limit) {
+  return fmaxf(-limit, fminf(limit, val));
+}
+
+size_t CMotorController::add(CDCmotor &motor, const motor_cfg_t &cfg, int encoder_pin) {
+  if (max_motors <= motors_.size()) {
+    return motors_.size();
+  }
+  motors_.emplace_back(new motor_t(motor, cfg));
+#ifdef _SIMULATION_
+  encoder_pin = 0; //simulated encoder on each motor
+#endif
+  if (no_encoder != encoder_pin) {
+    motors_.back()->encoder.reset(new CWheelEncoder(encoder_pin));
+  }
+  return motors_.size() - 1;
+}
+
+void CMotorController::init() {
+  for (size_t idx = 0; idx < motors_.size(); idx++) {
+    auto &m = *motors_[idx];
+    if (m.encoder) {
+      encoder_slots[idx] = m.encoder.get();
+      m.encoder->init(edge_handlers[idx]);
+    }
+    m.motor.init();
+  }
+  vbat_age_ = 0;
+  read_vbat();
+}
+
+void CMotorController::read_vbat() {
+  const auto mv = power_ ? power_->getVBAT() : -1;
+  //no reading (simulation): nominal
+  const auto scale = (0 < mv) ? static_cast<float>(mv) / vbat_nominal_mv : 1.f;
+  voltage_scale_.store(fmaxf(0.5f, scale), std::memory_order_relaxed);
+}
+
+void CMotorController::set(size_t idx, float target) {
+  if (motors_.size() <= idx) {
+    return;
+  }
+  auto &m = *motors_[idx];
+  target = clamp(target, 100);
+  m.target.store(target, std::memory_order_relaxed);
+  flight_recorder.value(rec_motor, m.motor.getPin(), static_cast<int32_t>(lrintf(target)));
+  if (!actuator_tick.isTicking()) { //no control loop, direct
+    m.output.store(target, std::memory_order_relaxed);
+    m.motor.write(target);
+  }
+}
+
+void CMotorController::step(float dt) {
+  const auto started = chrono::steady_clock::now();
+  if (0 == cycles_.load(std::memory_order_relaxed)) {
+    started_ = started;
+  }
+  //paced by tick time, replay reads as many samples whatever its speed
+  vbat_age_ += dt;
+  if (vbat_period_ms <= vbat_age_ * 1000) {
+    vbat_age_ = 0;
+    read_vbat();
+  }
+  const auto voltage_scale = voltage_scale_.load(std::memory_order_relaxed);
+  CPwmRegistry::Batch batch(pwm_registry); //all motors in one frame
+  for (auto &mp : motors_) {
+    auto &m = *mp;
+    const auto target = m.target.load(std::memory_order_relaxed);
+    const auto max_step = m.cfg.slew * dt;
+    m.setpoint += clamp(target - m.setpoint, max_step);
+    //feed forward, same voltage on motor whatever battery is
+    auto output = m.setpoint / voltage_scale;
+    if (m.encoder) {
+      const auto drive = m.output.load(std::memory_order_relaxed);
+#ifdef _SIMULATION_
+      m.encoder->simulate(dt, drive, voltage_scale);
+#endif
+      const auto counts = m.encoder->poll(drive);
+      const auto measured = counts / dt;
+      const auto speed = m.speed.load(std::memory_order_relaxed);
+      const auto filtered = speed + (measured - speed) * 0.5f;
+      m.speed.store(filtered, std::memory_order_relaxed);
+      if (0 < m.cfg.kp) {
+        const auto err = m.setpoint * m.cfg.max_cps / 100 - filtered;
+        //derivative on measurement, no kick on setpoint change
+        const auto derivative = -(filtered - m.prev_speed) / dt;
+        m.prev_speed = filtered;
+        const auto integral = m.integral + err * dt;
+        const auto correction = m.cfg.kp * err + m.cfg.ki * integral + m.cfg.kd * derivative;
+        if (100 >= fabsf(output + correction)) { //anti windup: integrate while not saturated
+          m.integral = integral;
+        }
+        output += correction;
+        if ((0 == target) && (0 == m.setpoint)) { //stopped, no hold current
+          m.integral = 0;
+          output = 0;
+        }
+      }
+    }
+    output = clamp(output, 100);
+    m.output.store(output, std::memory_order_relaxed);
+    m.motor.write(output);
+  }
+  const auto ns = static_cast<uint32_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count());
+  cycles_.fetch_add(1, std::memory_order_relaxed);
+  cpu_sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+  if (ns > cpu_max_ns_.load(std::memory_order_relaxed)) { //single writer
+    cpu_max_ns_.store(ns, std::memory_order_relaxed);
+  }
+}
+
+float CMotorController::getCycleRate() const {
+  const auto cycles = getCycles();
+  const auto seconds = chrono::duration<float>(chrono::steady_clock::now() - started_).count();
+  return (cycles && (0 < seconds)) ? cycles / seconds : 0;
+}
+
+uint32_t CMotorController::getCpuAvgNs() const {
+  const auto cycles = getCycles();
+  return cycles ? cpu_sum_ns_.load(std::memory_order_relaxed) / cycles : 0;
+}
+
+void motor_bench() {
+#ifndef _SIMULATION_
+  cout << "motor bench runs on simulated encoders, build with SIMULATION=1" << endl;
+  return;
+#endif
+  //step 0 -> 60% -> reversal -60%, open loop and speed loop
+  constexpr auto rate_hz = 50;
+  constexpr auto dt = 1.f / rate_hz;
+  for (const auto closed : { false, true }) {
+    CDCmotor motor(0, 1);
+    CMotorController controller(nullptr);
+    controller.add(motor, { 200, closed ? 0.05f : 0, closed ? 0.1f : 0, 0, CWheelEncoder::sim_max_cps });
+    const auto speed_ref = 0.6f * CWheelEncoder::sim_max_cps;
+    float peak = 0;
+    auto rise_ms = -1;
+    auto reverse_ms = -1;
+    controller.set(0, 60);
+    for (auto tick = 0; tick < 4 * rate_hz; tick++) {
+      const auto ms = tick * 1000 / rate_hz;
+      if (2 * rate_hz == tick) {
+        controller.set(0, -60);
+      }
+      controller.step(dt);
+      const auto speed = controller.getSpeed(0);
+      if (tick < 2 * rate_hz) {
+        peak = fmaxf(peak, speed);
+        if ((0 > rise_ms) && (0.9f * speed_ref <= speed)) {
+          rise_ms = ms;
+        }
+      } else if ((0 > reverse_ms) && (-0.9f * speed_ref >= speed)) {
+        reverse_ms = ms - 2000;
+      }
+    }
+    cout << "motor " << (closed ? "pid" : "open loop") << " 60% rise90=" << rise_ms << "ms reverse90=" << reverse_ms
+        << "ms peak=" << peak * 100 / CWheelEncoder::sim_max_cps << "% final=" << controller.getSpeed(0) * 100 /
+        CWheelEncoder::sim_max_cps << "% cpu avg=" << controller.getCpuAvgNs() << "ns max=" << controller.getCpuMaxNs()
+        << "ns" << endl;
+  }
+}
@@ -0,0 +1,110 @@
+/*
+ * CMotorController.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CMOTORCONTROLLER_H_
+#define CMOTORCONTROLLER_H_
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include "CDCmotor.h"
+#include "CWheelEncoder.h"
+#include "CPower.h"
+
+struct motor_cfg_t {
+  float slew; //%/s, target ramp
+  //speed loop, used with encoder, gains in % per counts/s
+  float kp;
+  float ki;
+  float kd;
+  float max_cps; //counts/s at 100%
+};
+
+/***
+ * DC motor control, stepped by actuator tick:
+ * target is ramped with slew limit, open loop output is scaled by nominal/battery voltage,
+ * with encoder PID corrects output to reach target speed.
+ * Target: -100..100 % of power (open loop) or of max_cps (closed loop)
+ */
+class CMotorController {
+public:
+  static constexpr size_t max_motors = 4; //limited by encoder isr trampolines
+  static constexpr int no_encoder = -1;
+  static constexpr int16_t vbat_nominal_mv = 7400; //2S LiPo
+  static constexpr uint32_t vbat_period_ms = 1000; //ADC read takes ms, not each tick
+private:
+  struct motor_t {
+    CDCmotor &motor;
+    motor_cfg_t cfg;
+    std::unique_ptr<CWheelEncoder> encoder;
+    std::atomic<float> target { 0 };
+    //owned by tick
+    float setpoint = 0;
+    float integral = 0;
+    float prev_speed = 0;
+    std::atomic<float> speed { 0 }; //counts/s, filtered
+    std::atomic<float> output { 0 };
+    motor_t(CDCmotor &_motor, const motor_cfg_t &_cfg) :
+        motor(_motor), cfg(_cfg) {
+    }
+  };
+  const CPower *power_;
+  std::vector<std::unique_ptr<motor_t>> motors_;
+  std::atomic<float> voltage_scale_ { 1 }; //battery/nominal
+  float vbat_age_ = 0; //s since VBAT read, owned by tick
+
+  std::atomic<uint32_t> cycles_ { 0 };
+  std::atomic<uint64_t> cpu_sum_ns_ { 0 };
+  std::atomic<uint32_t> cpu_max_ns_ { 0 };
+  std::chrono::steady_clock::time_point started_;
+  void read_vbat();
+public:
+  CMotorController(const CPower *power) :
+      power_(power) {
+  }
+  //motors are added before init, ret index
+  size_t add(CDCmotor &motor, const motor_cfg_t &cfg, int encoder_pin = no_encoder);
+  void init();
+  void set(size_t idx, float target);
+  void step(float dt);
+  size_t getCount() const {
+    return motors_.size();
+  }
+  bool isClosedLoop(size_t idx) const {
+    return motors_[idx]->encoder && (0 < motors_[idx]->cfg.kp);
+  }
+  float getTarget(size_t idx) const {
+    return motors_[idx]->target.load(std::memory_order_relaxed);
+  }
+  float getOutput(size_t idx) const {
+    return motors_[idx]->output.load(std::memory_order_relaxed);
+  }
+  float getSpeed(size_t idx) const {
+    return motors_[idx]->speed.load(std::memory_order_relaxed);
+  }
+  //-1: no encoder
+  int32_t getCount(size_t idx) const {
+    return motors_[idx]->encoder ? motors_[idx]->encoder->getCount() : -1;
+  }
+  float getVoltageScale() const {
+    return voltage_scale_.load(std::memory_order_relaxed);
+  }
+  uint32_t getCycles() const {
+    return cycles_.load(std::memory_order_relaxed);
+  }
+  float getCycleRate() const;
+  uint32_t getCpuAvgNs() const;
+  uint32_t getCpuMaxNs() const {
+    return cpu_max_ns_.load(std::memory_order_relaxed);
+  }
+};
+
+extern CMotorController motor_controller;
+
+void motor_bench();
+#endif /* CMOTORCONTROLLER_H_ */
@@ -0,0 +1,434 @@
+/*
+ * CPca9685.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CPca9685.h"
+#include "CFlightRecorder.h"
+#include <unistd.h>
+#include <stdio.h>
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <string>
+#ifdef _SIMULATION_
+#include "CI2cSim.h"
+#endif
+
+using namespace std;
+
+CPca9685 pca9685(1, 0x40);
+
+thread_local CPca9685::Batch *CPca9685::current_batch_ = nullptr;
+
+CPca9685::CPca9685(uint8_t bus, uint8_t address) :
+    bus_(bus), address_(address), i2c_(i2c_bus(bus)) {
+  for (uint32_t pos = 0; pos < queue_size; pos++) {
+    queue_[pos].seq.store(pos, std::memory_order_relaxed);
+  }
+  sem_init(&sem_, 0, 0);
+}
+
+CPca9685::~CPca9685() {
+  stop();
+  sem_destroy(&sem_);
+}
+
+bool CPca9685::init(float freq) {
+  //register setup as wiringPi pca9685 node, through bus so it is profiled
+  const auto write_reg = [this](uint8_t reg, uint8_t value) {
+    return 0 == i2c_.writeReg(address_, reg, &value, 1, i2c_motor);
+  };
+  uint8_t mode1;
+  if (0 != i2c_.readReg(address_, MODE1, &mode1, 1, i2c_motor)) {
+    return false;
+  }
+  mode1 = (mode1 & 0x7f) | 0x20; //restart cleared, auto-increment
+  if (!write_reg(MODE1, mode1)) {
+    return false;
+  }
+  i2c_.setAutoIncrement(address_);
+  if (0 < freq) {
+    freq = min(1000.f, max(40.f, freq));
+    const auto prescale = static_cast<uint8_t>(25000000.0f / (4096 * freq) - 0.5f); //25 MHz oscillator
+    //prescale is written in sleep
+    write_reg(MODE1, mode1 | 0x10);
+    write_reg(PRESCALE, prescale);
+  }
+  //all channels full off before outputs run
+  const uint8_t all_off[4] = { 0, 0, 0, FULL_BIT >> 8 };
+  i2c_.writeReg(address_, ALL_LED_ON_L, all_off, sizeof(all_off), i2c_motor);
+  //chip powers up sleeping, oscillator needs 500us after wake up before restart
+  mode1 &= ~0x10;
+  if (!write_reg(MODE1, mode1)) {
+    return false;
+  }
+  this_thread::sleep_for(chrono::microseconds(500));
+  write_reg(MODE1, mode1 | 0x80);
+  shadow_.fill(0); //reset sets all full off
+  shadow_valid_ = 0xffff;
+  pending_ = shadow_;
+  dirty_ = 0;
+  return start();
+}
+
+bool CPca9685::start() {
+  if (owner_none != owner_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  owner_.store(owner_writer, std::memory_order_release);
+  start_writer();
+  return true;
+}
+
+void CPca9685::start_writer() {
+  writer_ = std::thread([this] {
+    while (owner_writer == owner_.load(std::memory_order_acquire)) {
+      sem_wait(&sem_);
+      service();
+    }
+  });
+}
+
+void CPca9685::stop() {
+  if (owner_none == owner_.exchange(owner_none, std::memory_order_acq_rel)) {
+    return;
+  }
+  sem_post(&sem_);
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  service(); //leftovers
+}
+
+void CPca9685::setTickOwner(bool tick) {
+  //producers keep queuing while owner changes
+  if (tick) {
+    if (owner_writer == owner_.exchange(owner_tick, std::memory_order_acq_rel)) {
+      sem_post(&sem_);
+      writer_.join();
+    }
+  } else if (owner_tick == owner_.load(std::memory_order_acquire)) { //tick is stopped
+    owner_.store(owner_writer, std::memory_order_release);
+    start_writer();
+    sem_post(&sem_); //queued since last tick
+  }
+}
+
+bool CPca9685::try_push(const pwm_cmd_t &cmd) {
+  auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+  for (;;) {
+    auto &cell = queue_[pos % queue_size];
+    const auto diff = static_cast<int32_t>(cell.seq.load(std::memory_order_acquire) - pos);
+    if (0 == diff) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cell.cmd = cmd;
+        cell.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (0 > diff) {
+      return false; //full
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool CPca9685::pop(pwm_cmd_t &cmd) {
+  auto &cell = queue_[dequeue_pos_ % queue_size];
+  if (0 > static_cast<int32_t>(cell.seq.load(std::memory_order_acquire) - (dequeue_pos_ + 1))) {
+    return false; //empty
+  }
+  cmd = cell.cmd;
+  cell.seq.store(dequeue_pos_ + queue_size, std::memory_order_release);
+  dequeue_pos_++;
+  return true;
+}
+
+void CPca9685::push(const pwm_cmd_t &cmd) {
+  commands_.fetch_add(1, std::memory_order_relaxed);
+  const auto owner = owner_.load(std::memory_order_acquire);
+  if (owner_none == owner) { //no owner yet, single thread start up
+    write(cmd);
+    return;
+  }
+  while (!try_push(cmd)) {
+    queue_full_.fetch_add(1, std::memory_order_relaxed);
+    this_thread::yield();
+  }
+  if (owner_writer == owner) {
+    sem_post(&sem_);
+  }
+}
+
+void CPca9685::service() {
+  pwm_cmd_t cmd;
+  while (pop(cmd)) {
+    apply(cmd);
+  }
+  flush();
+}
+
+CPca9685::Batch::Batch(CPca9685 &dev) :
+    dev_(dev), outer_(current_batch_) {
+  cmd_.mask = 0;
+  current_batch_ = this;
+}
+
+CPca9685::Batch::~Batch() {
+  current_batch_ = outer_;
+  if (0 == cmd_.mask) {
+    return;
+  }
+  dev_.submit(cmd_); //nested, outer batch pushes
+}
+
+void CPca9685::merge(pwm_cmd_t &dst, const pwm_cmd_t &src) {
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    if (src.mask & (1 << channel)) {
+      dst.value[channel] = src.value[channel];
+    }
+  }
+  dst.mask |= src.mask;
+}
+
+void CPca9685::stage(pwm_cmd_t &cmd, uint8_t channel, uint16_t value) {
+  if (channels <= channel) {
+    return;
+  }
+  if (maxPWM < value) {
+    value = maxPWM;
+  }
+  flight_recorder.value(rec_pwm, channel_base_ + channel, value);
+  cmd.value[channel] = value;
+  cmd.mask |= 1 << channel;
+}
+
+void CPca9685::submit(const pwm_cmd_t &cmd) {
+  for (auto batch = current_batch_; batch; batch = batch->outer_) {
+    if (&batch->dev_ == this) {
+      merge(batch->cmd_, cmd);
+      return;
+    }
+  }
+  push(cmd);
+}
+
+void CPca9685::set(uint8_t channel, uint16_t value) {
+  pwm_cmd_t cmd;
+  cmd.mask = 0;
+  stage(cmd, channel, value);
+  if (cmd.mask) {
+    submit(cmd);
+  }
+}
+
+void CPca9685::apply(const pwm_cmd_t &cmd) {
+  for (uint8_t channel = 0; channel < channels; channel++) {
+    const uint16_t mask = 1 << channel;
+    if (0 == (cmd.mask & mask)) {
+      continue;
+    }
+    const auto value = cmd.value[channel];
+    pending_[channel] = value;
+    if ((shadow_valid_ & mask) && (shadow_[channel] == value)) {
+      dirty_ &= ~mask; //back to value on chip
+      shadow_hits_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      dirty_ |= mask;
+      shadow_misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
+
+bool CPca9685::write_run(uint8_t first, uint8_t count) {
+  uint8_t buf[1 + 4 * channels];
+  buf[0] = LED0_ON_L + 4 * first;
+  auto p = &buf[1];
+  for (auto channel = first; channel < first + count; channel++) {
+    const auto value = pending_[channel];
+    const uint16_t on = (maxPWM <= value) ? FULL_BIT : 0;
+    const uint16_t off = (0 == value) ? FULL_BIT : ((maxPWM <= value) ? 0 : value);
+    *p++ = on & 0xff;
+    *p++ = on >> 8;
+    *p++ = off & 0xff;
+    *p++ = off >> 8;
+  }
+  const uint16_t run = ((1 << count) - 1) << first;
+  const auto len = static_cast<size_t>(p - buf);
+  stats_.account(len);
+  if (0 != i2c_.write(address_, buf, len, i2c_motor)) {
+    perror("pca9685 write");
+    shadow_valid_ &= ~run; //partial write possible, chip content unknown
+    return false;
+  }
+  for (auto channel = first; channel < first + count; channel++) {
+    shadow_[channel] = pending_[channel];
+  }
+  shadow_valid_ |= run;
+  return true;
+}
+
+void CPca9685::flush() {
+  uint16_t failed = 0;
+  uint8_t channel = 0;
+  while (dirty_) {
+    while (0 == (dirty_ & (1 << channel))) {
+      channel++;
+    }
+    auto count = 0;
+    while ((channel + count < channels) && (dirty_ & (1 << (channel + count)))) {
+      dirty_ &= ~(1 << (channel + count));
+      count++;
+    }
+    if (!write_run(channel, count)) {
+      failed |= ((1 << count) - 1) << channel;
+    }
+    channel += count;
+  }
+  dirty_ = failed; //retried with next frame
+}
+
+//same updates as wiringPi pwmWrite per channel: two 16bit register writes,
+//full on/off does read-modify-write
+static void account_legacy(i2c_stats_t &legacy, uint16_t value) {
+  if (0 == value) {
+    legacy.account(1);
+    legacy.account(1);
+    legacy.account(2);
+  } else if (CPca9685::maxPWM <= value) {
+    for (auto cnt = 0; cnt < 2; cnt++) {
+      legacy.account(1);
+      legacy.account(1);
+      legacy.account(2);
+    }
+  } else {
+    legacy.account(3);
+    legacy.account(3);
+  }
+}
+
+void pwm_bench() {
+#ifndef _SIMULATION_
+  cout << "pwm bench runs on simulated bus, build with SIMULATION=1" << endl;
+  return;
+#else
+  //typical commands: wheels (4 channels), manipulator (3), camera (1),
+  //joystick repeats same wheel command at high rate
+  struct {
+    const char *name;
+    uint8_t first;
+    uint8_t count;
+    bool repeat;
+  } const cases[] = {
+    { "wheels", 0, 4, false },
+    { "manipulator", 4, 3, false },
+    { "camera", 15, 1, false },
+    { "joystick", 0, 4, true },
+  };
+  constexpr auto iterations = 1000;
+  auto &chip = sim_pca9685(0, 0x40);
+  CPca9685 dev(0, 0x40);
+  dev.init(0);
+  dev.stop(); //cost of frame only, writes in this thread
+  for (const auto &bench_case : cases) {
+    dev.resetStats();
+    const auto started = chrono::steady_clock::now();
+    for (auto iteration = 0; iteration < iterations; iteration++) {
+      CPca9685::Batch batch(dev);
+      for (auto channel = bench_case.first; channel < bench_case.first + bench_case.count; channel++) {
+        dev.set(channel, 200 + (bench_case.repeat ? iteration / 10 : iteration + channel) % 400);
+      }
+    }
+    const auto cpu_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    i2c_stats_t legacy;
+    for (auto iteration = 0; iteration < iterations; iteration++) {
+      for (auto channel = bench_case.first; channel < bench_case.first + bench_case.count; channel++) {
+        account_legacy(legacy, 200 + (bench_case.repeat ? iteration / 10 : iteration + channel) % 400);
+      }
+    }
+    const auto &frame = dev.getStats();
+    cout << "pwm " << bench_case.name << " per command: frame " << static_cast<float>(frame.transactions) / iterations
+        << " transactions " << static_cast<float>(frame.bytes) / iterations << " bytes "
+        << frame.bus_ns / iterations / 1000 << "us"
+        << " | per channel " << legacy.transactions / iterations << " transactions " << legacy.bytes / iterations
+        << " bytes " << legacy.bus_ns / iterations / 1000 << "us"
+        << " | shadow hits " << dev.getShadowHits() << " misses " << dev.getShadowMisses()
+        << " | cpu " << cpu_ns / iterations << "ns" << endl;
+  }
+  //chip outputs follow last command of every channel
+  uint8_t mismatched = 0;
+  for (uint8_t channel = 0; channel < CPca9685::channels; channel++) {
+    mismatched += chip.getDuty(channel) != dev.getShadow(channel);
+  }
+  cout << "pwm chip writes=" << chip.getWrites() << " mismatched channels=" << static_cast<unsigned>(mismatched) << endl;
+#endif
+}
+
+void pwm_contention_bench() {
+#ifndef _SIMULATION_
+  cout << "pwm bench runs on simulated bus, build with SIMULATION=1" << endl;
+  return;
+#else
+  //radar thread moves dir servo, http thread sends wheel commands, same board
+  struct writer_stats_t {
+    uint32_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+  };
+  sim_pca9685(0, 0x40);
+  i2c_bus(0).setBusDelay(true); //write holds bus for transaction time
+  for (const auto queued : { false, true }) {
+    CPca9685 dev(0, 0x40);
+    dev.init(0);
+    if (!queued) {
+      dev.stop();
+    }
+    mutex mu; //previous global servo mutex
+    atomic<bool> execute { true };
+    writer_stats_t stats[2];
+    auto writer = [&](uint8_t first, uint8_t count, writer_stats_t &st) {
+      uint16_t value = 200;
+      while (execute.load(std::memory_order_acquire)) {
+        pwm_cmd_t cmd;
+        cmd.mask = ((1 << count) - 1) << first;
+        for (auto channel = first; channel < first + count; channel++) {
+          cmd.value[channel] = value;
+        }
+        value = (value + 7) % 400 + 200;
+        const auto started = chrono::steady_clock::now();
+        if (queued) {
+          dev.push(cmd);
+        } else {
+          lock_guard<mutex> guard(mu);
+          dev.write(cmd);
+        }
+        const uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+        st.calls++;
+        st.total_ns += ns;
+        st.max_ns = max(st.max_ns, ns);
+        this_thread::sleep_for(chrono::microseconds(500));
+      }
+    };
+    thread radar_thd(writer, 14, 1, ref(stats[0]));
+    thread http_thd(writer, 0, 4, ref(stats[1]));
+    this_thread::sleep_for(chrono::seconds(1));
+    execute.store(false, std::memory_order_release);
+    radar_thd.join();
+    http_thd.join();
+    dev.stop();
+    const char *names[] = { "radar", "http" };
+    for (auto idx = 0; idx < 2; idx++) {
+      cout << "pwm " << (queued ? "queue" : "mutex") << " " << names[idx] << " calls=" << stats[idx].calls
+          << " avg=" << stats[idx].total_ns / max<uint32_t>(stats[idx].calls, 1) << "ns max=" << stats[idx].max_ns
+          << "ns" << endl;
+    }
+    cout << "pwm " << (queued ? "queue" : "mutex") << " transactions=" << dev.getStats().transactions
+        << " queue_full=" << dev.getQueueFull() << endl;
+  }
+  i2c_bus(0).setBusDelay(false);
+#endif
+}
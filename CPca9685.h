@@ -0,0 +1,159 @@
+/*
+ * CPca9685.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CPCA9685_H_
+#define CPCA9685_H_
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <semaphore.h>
+#include "I2cStats.h"
+#include "CI2cBus.h"
+
+struct pwm_cmd_t {
+  uint16_t mask; //channels to set
+  std::array<uint16_t, 16> value;
+};
+
+/***
+ * PCA9685 frame: channel updates are staged and flushed as
+ * one auto-increment block write per contiguous run of changed LEDn registers.
+ * Chip latches outputs on STOP, so one block write is applied atomically.
+ *
+ * Device has single owner: producers push commands in lock-free queue,
+ * writer thread (or actuator tick) drains it, applies commands to frame and flushes.
+ */
+class CPca9685 {
+public:
+  static constexpr uint8_t channels = 16;
+  static constexpr uint16_t maxPWM = 0xfff + 1; //full on
+  static constexpr uint8_t LED0_ON_L = 0x06;
+  static constexpr uint16_t FULL_BIT = 0x1000;
+  static constexpr uint8_t MODE1 = 0x00;
+  static constexpr uint8_t PRESCALE = 0xfe;
+  static constexpr uint8_t ALL_LED_ON_L = 0xfa;
+  static constexpr uint32_t queue_size = 64; //power of 2
+  enum owner_t : uint8_t {
+    owner_none, //push writes in caller thread
+    owner_writer, //own writer thread
+    owner_tick //service() is called by actuator tick
+  };
+private:
+  const uint8_t bus_;
+  const uint8_t address_;
+  uint16_t channel_base_ = 0; //global channel of LED0, for record
+  CI2cBus &i2c_;
+  //owned by writer
+  uint16_t dirty_ = 0;
+  std::array<uint16_t, channels> pending_ { };
+  //last value written to chip, unchanged registers are not sent
+  std::array<uint16_t, channels> shadow_ { };
+  uint16_t shadow_valid_ = 0;
+  uint32_t dequeue_pos_ = 0;
+  //bounded multi-producer queue, cell sequence tells who owns the cell
+  struct cell_t {
+    std::atomic<uint32_t> seq;
+    pwm_cmd_t cmd;
+  };
+  std::array<cell_t, queue_size> queue_;
+  std::atomic<uint32_t> enqueue_pos_ { 0 };
+  sem_t sem_;
+  std::atomic<uint8_t> owner_ { owner_none };
+  std::thread writer_;
+
+  std::atomic<uint32_t> shadow_hits_ { 0 };
+  std::atomic<uint32_t> shadow_misses_ { 0 };
+  std::atomic<uint32_t> commands_ { 0 };
+  std::atomic<uint32_t> queue_full_ { 0 };
+  i2c_stats_t stats_;
+  bool try_push(const pwm_cmd_t &cmd);
+  bool pop(pwm_cmd_t &cmd);
+  void apply(const pwm_cmd_t &cmd);
+  void flush();
+  bool write_run(uint8_t first, uint8_t count);
+  void start_writer();
+public:
+  CPca9685(uint8_t bus, uint8_t address);
+  ~CPca9685();
+  bool init(float freq);
+  bool start();
+  void stop();
+  //tick: writer thread is stopped, frame is written once per tick by service(),
+  //tick thread must be stopped before owner is given back to writer
+  void setTickOwner(bool tick);
+  uint8_t getBus() const {
+    return bus_;
+  }
+  uint8_t getAddress() const {
+    return address_;
+  }
+  void setChannelBase(uint16_t base) {
+    channel_base_ = base;
+  }
+  //value: 0 - full off, maxPWM - full on
+  void set(uint8_t channel, uint16_t value);
+  //adds channel to cmd: value is clamped and recorded, caller submits cmd
+  void stage(pwm_cmd_t &cmd, uint8_t channel, uint16_t value);
+  //to this thread's batch of device or to queue
+  void submit(const pwm_cmd_t &cmd);
+  static void merge(pwm_cmd_t &dst, const pwm_cmd_t &src);
+  void push(const pwm_cmd_t &cmd);
+  //drains queue and writes frame, called by owner only
+  void service();
+  //synchronous write in caller thread, for owner or single thread use
+  void write(const pwm_cmd_t &cmd) {
+    apply(cmd);
+    flush();
+  }
+  const i2c_stats_t& getStats() const {
+    return stats_;
+  }
+  //last value written to chip, owner thread only
+  uint16_t getShadow(uint8_t channel) const {
+    return shadow_[channel % channels];
+  }
+  uint32_t getShadowHits() const {
+    return shadow_hits_.load(std::memory_order_relaxed);
+  }
+  uint32_t getShadowMisses() const {
+    return shadow_misses_.load(std::memory_order_relaxed);
+  }
+  uint32_t getCommands() const {
+    return commands_.load(std::memory_order_relaxed);
+  }
+  uint32_t getQueueFull() const {
+    return queue_full_.load(std::memory_order_relaxed);
+  }
+  void resetStats() {
+    stats_.reset();
+    shadow_hits_.store(0, std::memory_order_relaxed);
+    shadow_misses_.store(0, std::memory_order_relaxed);
+    commands_.store(0, std::memory_order_relaxed);
+    queue_full_.store(0, std::memory_order_relaxed);
+  }
+  /***
+   * collects all set() of this thread in scope, pushes one command on exit
+   */
+  class Batch {
+    CPca9685 &dev_;
+    Batch *outer_;
+    pwm_cmd_t cmd_;
+    friend class CPca9685;
+  public:
+    Batch(CPca9685 &dev);
+    ~Batch();
+  };
+private:
+  static thread_local Batch *current_batch_;
+};
+
+extern CPca9685 pca9685;
+
+void pwm_bench();
+void pwm_contention_bench();
+#endif /* CPCA9685_H_ */
@@ -4,28 +4,71 @@
  *  Created on: Jan 18, 2019
  *      Author: ominenko
  */
-//https://github.com/Wyliodrin/wiringPi/blob/master/wiringPi/ads1115.c
+//https://www.ti.com/lit/ds/symlink/ads1115.pdf
 #include "CPower.h"
-#ifndef _SIMULATION_
-#include <wiringPi.h>
-#include <ads1115.h>
-#endif
+#include "CFlightRecorder.h"
+#include "CI2cBus.h"
+#include <thread>
+#include <chrono>
+using namespace std;
+
+constexpr uint32_t CPower::conversion_us;
 
 bool CPower::init() {
-#ifndef _SIMULATION_
-  if (false == ads1115Setup(BASE, 0x48)) {
+  uint8_t config[2];
+  if (0 != i2c_bus(BUS).readReg(ADDRESS, REG_CONFIG, config, sizeof(config), i2c_telemetry)) {
     return false;
   }
-  auto node = wiringPiFindNode(BASE + 0);
-  node->data0 = CONFIG_PGA_6_144V;
-#endif
   return true;
 }
+
+int16_t CPower::convert(uint8_t pin) const {
+  lock_guard<mutex> guard(conversion_mu_);
+  auto &bus = i2c_bus(BUS);
+  const uint16_t config = CONFIG_OS | CONFIG_MUX_SINGLE | (pin << 12) | CONFIG_PGA_6_144V | CONFIG_MODE_SINGLE
+      | CONFIG_DR_860SPS | CONFIG_COMP_QUE_DISABLE;
+  uint8_t buf[2] = { static_cast<uint8_t>(config >> 8), static_cast<uint8_t>(config & 0xff) };
+  if (0 != bus.writeReg(ADDRESS, REG_CONFIG, buf, sizeof(buf), i2c_telemetry)) {
+    return -1;
+  }
+  this_thread::sleep_for(chrono::microseconds(conversion_us));
+  for (auto poll = 0;; poll++) {
+    if (0 != bus.readReg(ADDRESS, REG_CONFIG, buf, sizeof(buf), i2c_telemetry)) {
+      return -1;
+    }
+    if (buf[0] & (CONFIG_OS >> 8)) {
+      break;
+    }
+    if (max_polls <= poll) {
+      return -1;
+    }
+    this_thread::sleep_for(chrono::microseconds(100));
+  }
+  if (0 != bus.readReg(ADDRESS, REG_CONVERSION, buf, sizeof(buf), i2c_telemetry)) {
+    return -1;
+  }
+  const auto raw = static_cast<int16_t>((buf[0] << 8) | buf[1]);
+  return static_cast<int32_t>(raw) * 6144 / 0x7fff;
+}
+void CPower::inject(uint8_t pin, int16_t mv) {
+  if (pin < replay_values_.size()) {
+    lock_guard<mutex> guard(replay_mu_);
+    replay_values_[pin].push_back(mv);
+  }
+}
+
 int16_t CPower::getAIN(const uint8_t pin) const {
-#ifndef _SIMULATION_
-  return static_cast<int32_t>(analogRead(BASE + pin)) * 6144 / 0x7fff;
-#else
-  return -1;
-#endif
+  if (replay_ && (pin < replay_values_.size())) {
+    lock_guard<mutex> guard(replay_mu_);
+    if (!replay_values_[pin].empty()) {
+      replay_last_[pin] = replay_values_[pin].front();
+      replay_values_[pin].pop_front();
+    }
+    flight_recorder.value(rec_power, pin, replay_last_[pin]);
+    return replay_last_[pin];
+  }
+  const int16_t mv = convert(pin & 3);
+  flight_recorder.value(rec_power, pin, mv);
+  return mv;
 }
 
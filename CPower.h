@@ -8,16 +8,44 @@
 #ifndef CPOWER_H_
 #define CPOWER_H_
 #include <stdint.h>
+#include <deque>
+#include <mutex>
+#include <array>
 
+/***
+ * ADS1115 single shot conversions over shared i2c bus as telemetry transactions.
+ * Conversion time is waited off bus, so motor and imu transfers go meanwhile.
+ */
 class CPower {
-  static constexpr auto BASE = 2222;
-  static constexpr auto CONFIG_PGA_6_144V = 0x0000;
+  static constexpr uint8_t BUS = 1;
+  static constexpr uint8_t ADDRESS = 0x48;
+  static constexpr uint8_t REG_CONVERSION = 0x00;
+  static constexpr uint8_t REG_CONFIG = 0x01;
+  static constexpr uint16_t CONFIG_OS = 0x8000; //write: start, read: idle
+  static constexpr uint16_t CONFIG_MUX_SINGLE = 0x4000; //AINx against GND, x in bits 12..13
+  static constexpr uint16_t CONFIG_PGA_6_144V = 0x0000;
+  static constexpr uint16_t CONFIG_MODE_SINGLE = 0x0100;
+  static constexpr uint16_t CONFIG_DR_860SPS = 0x00e0;
+  static constexpr uint16_t CONFIG_COMP_QUE_DISABLE = 0x0003;
+  static constexpr uint32_t conversion_us = 1200; //860 SPS
+  static constexpr uint8_t max_polls = 10;
   static constexpr auto inA0 = 0;
   static constexpr auto inA1 = 1;
   static constexpr auto inA2 = 2;
   static constexpr auto inA3 = 3;
+  bool replay_ = false;
+  mutable std::mutex replay_mu_;
+  mutable std::array<std::deque<int16_t>, 4> replay_values_;
+  mutable std::array<int16_t, 4> replay_last_ { { -1, -1, -1, -1 } };
+  mutable std::mutex conversion_mu_; //chip converts one input at a time
+  int16_t convert(uint8_t pin) const;
 public:
   bool init();
+  //replay: reads return injected values in order, last one is repeated
+  void set_replay(bool replay) {
+    replay_ = replay;
+  }
+  void inject(uint8_t pin, int16_t mv);
   int16_t getAIN(const uint8_t pin) const; //in mV
   int16_t getVBAT() const {
         return getAIN(inA3) * 2; //Divider 10k+10k
@@ -0,0 +1,235 @@
+/*
+ * CPwmRegistry.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CPwmRegistry.h"
+#include <iostream>
+#include <chrono>
+#ifdef _SIMULATION_
+#include "CI2cSim.h"
+#endif
+
+using namespace std;
+
+CPwmRegistry pwm_registry(pca9685);
+
+thread_local CPwmRegistry::Batch *CPwmRegistry::current_batch_ = nullptr;
+
+CPwmRegistry::CPwmRegistry(CPca9685 &first) {
+  //first board is only referenced, it may be not constructed yet
+  boards_.push_back(&first);
+  sem_init(&done_, 0, 0);
+}
+
+CPwmRegistry::~CPwmRegistry() {
+  stop_workers();
+  for (auto &bus : buses_) {
+    sem_destroy(&bus->go);
+  }
+  sem_destroy(&done_);
+}
+
+int CPwmRegistry::add(uint8_t bus, uint8_t address) {
+  if (max_boards <= boards_.size()) {
+    return -1;
+  }
+  for (const auto board : boards_) {
+    if ((board->getBus() == bus) && (board->getAddress() == address)) {
+      return -1;
+    }
+  }
+  owned_.emplace_back(new CPca9685(bus, address));
+  boards_.push_back(owned_.back().get());
+  return (boards_.size() - 1) * CPca9685::channels;
+}
+
+bool CPwmRegistry::init(float freq) {
+  auto ok = true;
+  for (size_t idx = 0; idx < boards_.size(); idx++) {
+    auto board = boards_[idx];
+    board->setChannelBase(idx * CPca9685::channels);
+    if (!board->init(freq)) {
+      cerr << "pca9685 bus=" << static_cast<int>(board->getBus()) << " address=0x" << hex
+          << static_cast<int>(board->getAddress()) << dec << " init failed" << endl;
+      ok = false;
+    }
+    bus_t *group = nullptr;
+    for (auto &bus : buses_) {
+      if (bus->bus == board->getBus()) {
+        group = bus.get();
+      }
+    }
+    if (!group) {
+      buses_.emplace_back(new bus_t);
+      group = buses_.back().get();
+      group->bus = board->getBus();
+      sem_init(&group->go, 0, 0);
+    }
+    group->boards.push_back(board);
+  }
+  return ok;
+}
+
+void CPwmRegistry::set(uint16_t channel, uint16_t value) {
+  const size_t board = channel / CPca9685::channels;
+  if (boards_.size() <= board) {
+    return;
+  }
+  const uint8_t local = channel % CPca9685::channels;
+  for (auto batch = current_batch_; batch; batch = batch->outer_) {
+    if (&batch->reg_ == this) {
+      if (0 == (batch->touched_ & (1 << board))) {
+        batch->cmds_[board].mask = 0;
+      }
+      boards_[board]->stage(batch->cmds_[board], local, value);
+      batch->touched_ |= 1 << board;
+      return;
+    }
+  }
+  boards_[board]->set(local, value);
+}
+
+void CPwmRegistry::setTickOwner(bool tick) {
+  if (!tick) {
+    stop_workers();
+  }
+  for (const auto board : boards_) {
+    board->setTickOwner(tick);
+  }
+  if (tick) {
+    start_workers();
+  }
+}
+
+void CPwmRegistry::start_workers() {
+  if ((2 > buses_.size()) || workers_run_.exchange(true)) {
+    return;
+  }
+  //first bus is flushed by tick thread itself
+  for (size_t idx = 1; idx < buses_.size(); idx++) {
+    buses_[idx]->worker = std::thread(&CPwmRegistry::worker_function, this, buses_[idx].get());
+  }
+}
+
+void CPwmRegistry::stop_workers() {
+  if (!workers_run_.exchange(false)) {
+    return;
+  }
+  for (size_t idx = 1; idx < buses_.size(); idx++) {
+    sem_post(&buses_[idx]->go);
+    buses_[idx]->worker.join();
+  }
+}
+
+void CPwmRegistry::worker_function(bus_t *bus) {
+  for (;;) {
+    sem_wait(&bus->go);
+    if (!workers_run_.load(std::memory_order_acquire)) {
+      return;
+    }
+    for (const auto board : bus->boards) {
+      board->service();
+    }
+    sem_post(&done_);
+  }
+}
+
+void CPwmRegistry::service() {
+  if (!workers_run_.load(std::memory_order_acquire)) {
+    for (const auto board : boards_) {
+      board->service();
+    }
+    return;
+  }
+  for (size_t idx = 1; idx < buses_.size(); idx++) {
+    sem_post(&buses_[idx]->go);
+  }
+  for (const auto board : buses_[0]->boards) {
+    board->service();
+  }
+  for (size_t idx = 1; idx < buses_.size(); idx++) {
+    sem_wait(&done_);
+  }
+}
+
+CPwmRegistry::Batch::Batch(CPwmRegistry &reg) :
+    reg_(reg), outer_(current_batch_) {
+  current_batch_ = this;
+}
+
+CPwmRegistry::Batch::~Batch() {
+  current_batch_ = outer_;
+  for (size_t board = 0; board < reg_.boards_.size(); board++) {
+    if (0 == (touched_ & (1 << board))) {
+      continue;
+    }
+    auto outer = outer_;
+    while (outer && (&outer->reg_ != &reg_)) {
+      outer = outer->outer_;
+    }
+    if (outer) { //nested, outer batch submits
+      if (0 == (outer->touched_ & (1 << board))) {
+        outer->cmds_[board].mask = 0;
+      }
+      CPca9685::merge(outer->cmds_[board], cmds_[board]);
+      outer->touched_ |= 1 << board;
+    } else {
+      reg_.boards_[board]->submit(cmds_[board]);
+    }
+  }
+}
+
+void pwm_boards_bench() {
+#ifndef _SIMULATION_
+  cout << "pwm bench runs on simulated bus, build with SIMULATION=1" << endl;
+  return;
+#else
+  //every channel of every board changes each frame, as in full body animation
+  constexpr auto frames = 100;
+  for (const auto separate : { false, true }) {
+    for (uint8_t boards = 1; boards <= 4; boards++) {
+      CPca9685 first(0, 0x40);
+      CPwmRegistry reg(first);
+      for (uint8_t board = 1; board < boards; board++) {
+        reg.add(separate ? board : 0, 0x40 + board);
+      }
+      for (size_t board = 0; board < reg.getBoards(); board++) {
+        auto &dev = reg.getBoard(board);
+        sim_pca9685(dev.getBus(), dev.getAddress());
+        i2c_bus(dev.getBus()).setBusDelay(true); //write holds bus for transaction time
+      }
+      reg.init(0);
+      reg.setTickOwner(true);
+      uint64_t frame_max_ns = 0;
+      const auto started = chrono::steady_clock::now();
+      for (auto frame = 0; frame < frames; frame++) {
+        const auto frame_started = chrono::steady_clock::now();
+        {
+          CPwmRegistry::Batch batch(reg);
+          for (uint16_t channel = 0; channel < reg.getChannels(); channel++) {
+            reg.set(channel, 200 + (frame + channel) % 400);
+          }
+        }
+        reg.service();
+        const uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - frame_started)
+            .count();
+        frame_max_ns = max(frame_max_ns, ns);
+      }
+      const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+      reg.setTickOwner(false);
+      cout << "pwm boards=" << static_cast<int>(boards) << " channels=" << reg.getChannels() << " buses="
+          << reg.getBuses() << " frame avg=" << ns / frames / 1000 << "us max=" << frame_max_ns / 1000 << "us"
+          << endl;
+      for (size_t board = 0; board < reg.getBoards(); board++) {
+        reg.getBoard(board).stop();
+      }
+    }
+  }
+  i2c_buses([](CI2cBus &bus) {
+    bus.setBusDelay(false);
+  });
+#endif
+}
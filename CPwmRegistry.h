@@ -0,0 +1,85 @@
+/*
+ * CPwmRegistry.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CPWMREGISTRY_H_
+#define CPWMREGISTRY_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <semaphore.h>
+#include "CPca9685.h"
+
+/***
+ * chained PCA9685 boards as one channel space: channel / 16 is board, channel % 16 is LEDn.
+ * Each board keeps own frame and owner. In tick mode boards of one bus are flushed one after
+ * another, different buses are flushed in parallel by bus workers.
+ */
+class CPwmRegistry {
+public:
+  static constexpr uint8_t max_boards = 8;
+private:
+  struct bus_t {
+    uint8_t bus;
+    std::vector<CPca9685*> boards;
+    std::thread worker;
+    sem_t go;
+  };
+  std::vector<CPca9685*> boards_;
+  std::vector<std::unique_ptr<CPca9685>> owned_;
+  std::vector<std::unique_ptr<bus_t>> buses_;
+  sem_t done_;
+  std::atomic<bool> workers_run_ { false };
+  void worker_function(bus_t *bus);
+  void start_workers();
+  void stop_workers();
+public:
+  CPwmRegistry(CPca9685 &first);
+  ~CPwmRegistry();
+  //before init; returns first channel of board, -1 on error
+  int add(uint8_t bus, uint8_t address);
+  bool init(float freq);
+  size_t getBoards() const {
+    return boards_.size();
+  }
+  size_t getBuses() const {
+    return buses_.size();
+  }
+  uint16_t getChannels() const {
+    return boards_.size() * CPca9685::channels;
+  }
+  CPca9685& getBoard(size_t idx) {
+    return *boards_[idx];
+  }
+  void set(uint16_t channel, uint16_t value);
+  void setTickOwner(bool tick);
+  //flushes all boards, called by tick
+  void service();
+  /***
+   * collects all set() of this thread in scope, one command per touched board on exit
+   */
+  class Batch {
+    CPwmRegistry &reg_;
+    Batch *outer_;
+    uint8_t touched_ = 0;
+    std::array<pwm_cmd_t, max_boards> cmds_;
+    friend class CPwmRegistry;
+  public:
+    Batch(CPwmRegistry &reg);
+    ~Batch();
+  };
+private:
+  static thread_local Batch *current_batch_;
+};
+
+extern CPwmRegistry pwm_registry;
+
+void pwm_boards_bench();
+#endif /* CPWMREGISTRY_H_ */
@@ -6,57 +6,235 @@
  */
 
 #include "CRadar.h"
+#include "CFlightRecorder.h"
 #include <iostream>
 #include <string>
+#include <stdlib.h>
 #ifdef _SIMULATION_
 #include <cstdlib>
 #endif
 
 using namespace std;
 
+//wiringPiISR takes plain function, so echo handlers are dispatched by slot
+static HC_SR04 *echo_slots[CRadar::max_sensors];
+template<size_t I>
+static void echo_trampoline() {
+  if (echo_slots[I]) {
+    echo_slots[I]->echo_handler();
+  }
+}
+static void (*const echo_handlers[CRadar::max_sensors])(void) = {
+  echo_trampoline<0>, echo_trampoline<1>, echo_trampoline<2>, echo_trampoline<3>,
+  echo_trampoline<4>, echo_trampoline<5>, echo_trampoline<6>, echo_trampoline<7>
+};
+
 CRadar::CRadar(uint8_t _trig, uint8_t _echo, uint8_t _direction) :
-    hc_sr04(_trig, _echo),
-    dir_servo(_direction, angle_min, angle_max, pwm_min, pwm_max) {
+    CRadar( { { _trig, _echo, 0, _direction } }) {
 }
 
-void CRadar::thread_function() {
-  map_mu_.lock();
-  surrond_[angle]= {
-    chrono::duration_cast< chrono::milliseconds >(chrono::system_clock::now().time_since_epoch()),
-    hc_sr04.measure()
+CRadar::CRadar(const std::vector<radar_sensor_cfg_t> &sensors) {
+  sensors_.reserve(max_sensors);
+  for (const auto &cfg : sensors) {
+    add_sensor(cfg);
+  }
+}
+
+bool CRadar::add_sensor(const radar_sensor_cfg_t &cfg) {
+  if ((max_sensors <= sensors_.size()) || execute_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  sensors_.emplace_back(cfg, (no_servo == cfg.servo_pin) ? 0 : angle_min);
+  if (no_servo != cfg.servo_pin) {
+    sensors_.back().dir_servo.reset(new pca9685_Servo(cfg.servo_pin, angle_min, angle_max, pwm_min, pwm_max));
+  }
+  return true;
+}
+
+void CRadar::init() {
+  for (size_t idx = 0; idx < sensors_.size(); idx++) {
+    echo_slots[idx] = &sensors_[idx].hc_sr04;
+    sensors_[idx].hc_sr04.init(echo_handlers[idx]);
+    if (sensors_[idx].dir_servo) {
+      sensors_[idx].dir_servo->init(sensors_[idx].angle);
+    }
+  }
+  make_groups();
+}
+
+bool CRadar::beams_overlap(const radar_sensor_cfg_t &a, const radar_sensor_cfg_t &b) const {
+  //coverage as center and half width, sweep sensor covers whole sweep range
+  auto half_width = [this](const radar_sensor_cfg_t &cfg) {
+    auto half = HC_SR04::BEAM_ANGLE / 2;
+    if (no_servo != cfg.servo_pin) {
+      half += (angle_max - angle_min) / 2;
+    }
+    return half;
+  };
+  auto center = [this](const radar_sensor_cfg_t &cfg) {
+    return cfg.mount_angle + ((no_servo != cfg.servo_pin) ? (angle_max + angle_min) / 2 : 0);
+  };
+  auto diff = abs(center(a) - center(b)) % 360;
+  if (180 < diff) {
+    diff = 360 - diff;
+  }
+  return diff < half_width(a) + half_width(b);
+}
+
+void CRadar::make_groups() {
+  //union-find over overlapping beams
+  vector<size_t> parent(sensors_.size());
+  for (size_t idx = 0; idx < parent.size(); idx++) {
+    parent[idx] = idx;
+  }
+  auto root = [&parent](size_t idx) {
+    while (parent[idx] != idx) {
+      idx = parent[idx];
+    }
+    return idx;
   };
+  for (size_t a = 0; a < sensors_.size(); a++) {
+    for (size_t b = a + 1; b < sensors_.size(); b++) {
+      if (beams_overlap(sensors_[a].cfg, sensors_[b].cfg)) {
+        parent[root(b)] = root(a);
+      }
+    }
+  }
+  groups_.clear();
+  map<size_t, size_t> group_by_root;
+  for (size_t idx = 0; idx < sensors_.size(); idx++) {
+    const auto r = root(idx);
+    auto it = group_by_root.find(r);
+    if (it == group_by_root.end()) {
+      it = group_by_root.emplace(r, groups_.size()).first;
+      groups_.emplace_back();
+    }
+    groups_[it->second].push_back(idx);
+  }
+}
+
+void CRadar::measure(sensor_t &sensor) {
+  std::this_thread::sleep_until(sensor.ready_at);
+  const auto distance = sensor.hc_sr04.measure();
+  store(sensor, chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()), distance);
+  advance(sensor);
+}
+
+void CRadar::inject(size_t idx, int16_t angle, int32_t distance, std::chrono::milliseconds time) {
+  if (idx >= sensors_.size()) {
+    return;
+  }
+  auto &sensor = sensors_[idx];
+  sensor.angle = angle;
+  store(sensor, time, distance);
+  advance(sensor);
+}
+
+void CRadar::store(sensor_t &sensor, std::chrono::milliseconds time, int32_t distance) {
+  map_mu_.lock();
+  sensor.surround[sensor.angle] = { time, distance };
   map_mu_.unlock();
-  if (angle_up) {
-    angle += HC_SR04::MEASURING_ANGLE;
+  readings_.fetch_add(1, std::memory_order_relaxed);
+  flight_recorder.radar(static_cast<uint16_t>(&sensor - sensors_.data()), sensor.angle, distance);
+}
+
+void CRadar::advance(sensor_t &sensor) {
+  if (!sensor.dir_servo) {
+    return;
+  }
+  if (sensor.angle_up) {
+    sensor.angle += HC_SR04::MEASURING_ANGLE;
   } else {
-    angle -= HC_SR04::MEASURING_ANGLE;
+    sensor.angle -= HC_SR04::MEASURING_ANGLE;
   }
-  if (angle_min >= angle) {
-    angle = angle_min;
-    angle_up = true;
+  if (angle_min >= sensor.angle) {
+    sensor.angle = angle_min;
+    sensor.angle_up = true;
   }
-  if (angle_max <= angle) {
-    angle = angle_max;
-    angle_up = false;
+  if (angle_max <= sensor.angle) {
+    sensor.angle = angle_max;
+    sensor.angle_up = false;
+  }
+  sensor.dir_servo->setVal(sensor.angle);
+  //time for set servo, other sensors of group are pinged meanwhile
+  sensor.ready_at = chrono::steady_clock::now()
+      + chrono::milliseconds(HC_SR04::MEASURING_ANGLE * sensor.dir_servo->angle_time * 2);
+}
+
+void CRadar::group_function(const std::vector<size_t> &group) {
+  for (const auto idx : group) {
+    if (!execute_.load(std::memory_order_acquire)) {
+      return;
+    }
+    measure(sensors_[idx]);
   }
-  dir_servo.setVal(angle);
-  std::this_thread::sleep_for(std::chrono::milliseconds(HC_SR04::MEASURING_ANGLE * dir_servo.angle_time * 2)); //time for set servo
 }
 
 bool CRadar::start() {
   if (execute_.load(std::memory_order_acquire)) {
     stop();
   };
+  if (groups_.empty()) {
+    make_groups();
+  }
+  readings_.store(0, std::memory_order_relaxed);
+  started_ = chrono::steady_clock::now();
   execute_.store(true, std::memory_order_release);
-  thd_ = std::thread([this] {
-    while (execute_.load(std::memory_order_acquire)) {
-      this->thread_function();
-    }
-  });
+  for (const auto &group : groups_) {
+    thds_.emplace_back([this, &group] {
+      while (execute_.load(std::memory_order_acquire)) {
+        this->group_function(group);
+      }
+    });
+  }
   return true;
 }
 void CRadar::stop() {
   execute_.store(false, std::memory_order_release);
-  if (thd_.joinable())
-    thd_.join();
+  for (auto &thd : thds_) {
+    if (thd.joinable())
+      thd.join();
+  }
+  thds_.clear();
+}
+
+float CRadar::getReadingsPerSecond() const {
+  const auto elapsed = chrono::duration_cast<chrono::duration<float>>(chrono::steady_clock::now() - started_).count();
+  if (0 >= elapsed) {
+    return 0;
+  }
+  return getReadings() / elapsed;
+}
+
+void radar_bench() {
+#ifndef _SIMULATION_
+  //sensors on pin 0 would take GPIO0 isr and echo slots of live radar
+  cout << "radar bench runs on simulated sensors, build with SIMULATION=1" << endl;
+  return;
+#else
+  //fixed sensors around chassis: separate beams scale, overlapped beams are serialized
+  struct {
+    const char *name;
+    size_t count;
+    int16_t spacing;
+  } const cases[] = {
+    { "separate", 1, 90 },
+    { "separate", 2, 90 },
+    { "separate", 4, 90 },
+    { "overlapped", 4, 10 },
+  };
+  for (const auto &bench_case : cases) {
+    vector<radar_sensor_cfg_t> cfg;
+    for (size_t idx = 0; idx < bench_case.count; idx++) {
+      cfg.push_back( { 0, 0, static_cast<int16_t>(idx * bench_case.spacing), CRadar::no_servo });
+    }
+    CRadar radar(cfg);
+    radar.init();
+    radar.start();
+    this_thread::sleep_for(chrono::seconds(2));
+    radar.stop();
+    cout << "radar " << bench_case.name << " sensors=" << bench_case.count << " groups=" << radar.getGroupCount()
+        << " readings/s=" << radar.getReadingsPerSecond() << endl;
+  }
+#endif
 }
@@ -13,52 +13,100 @@
 #include <mutex>
 #include <chrono>
 #include <map>
+#include <memory>
+#include <vector>
 #include "hc_sr04.h"
 #include "pca9685Servo.h"
 
 using surround_t=std::map<int16_t, std::pair<std::chrono::milliseconds, int32_t>>;
+
+struct radar_sensor_cfg_t {
+  uint8_t trig_pin;
+  uint8_t echo_pin;
+  int16_t mount_angle; //degree, 0 - forward, 90 - right, 180 - rear
+  int16_t servo_pin; //pca pin, CRadar::no_servo for fixed sensor
+};
+
+/***
+ * N ultrasonic sensors, each with optional sweep servo.
+ * Sensors with overlapping beams are put in one group and fire one by one,
+ * groups fire in parallel (one thread per group)
+ */
 class CRadar {
-  HC_SR04 hc_sr04;
-  void thread_function();
-  std::atomic<bool> execute_ { false };
-  std::thread thd_;
+public:
+  static constexpr int16_t no_servo = -1;
+  static constexpr size_t max_sensors = 8; //limited by echo isr trampolines
+private:
+  struct sensor_t {
+    radar_sensor_cfg_t cfg;
+    HC_SR04 hc_sr04;
+    std::unique_ptr<pca9685_Servo> dir_servo;
+    int16_t angle;
+    bool angle_up = true;
+    std::chrono::steady_clock::time_point ready_at; //servo settled
+    //<angle<timestamp,distance>>
+    surround_t surround;
+    sensor_t(const radar_sensor_cfg_t &_cfg, int16_t _angle) :
+        cfg(_cfg), hc_sr04(_cfg.trig_pin, _cfg.echo_pin), angle(_angle) {
+    }
+  };
   const int16_t angle_min = -90;
   const int16_t angle_max = 90;
   const int16_t pwm_max = 110;
   const int16_t pwm_min = 510;
-  int16_t angle = angle_min;
-  bool angle_up = true;
-  pca9685_Servo dir_servo;
+  std::vector<sensor_t> sensors_;
+  std::vector<std::vector<size_t>> groups_;
+  std::atomic<bool> execute_ { false };
+  std::vector<std::thread> thds_;
   std::mutex map_mu_;
-  //<angle<timestamp,distance>>
-  surround_t surrond_;
+  std::atomic<uint32_t> readings_ { 0 };
+  std::chrono::steady_clock::time_point started_;
+
+  void measure(sensor_t &sensor);
+  void store(sensor_t &sensor, std::chrono::milliseconds time, int32_t distance);
+  void advance(sensor_t &sensor);
+  void group_function(const std::vector<size_t> &group);
+  void make_groups();
+  bool beams_overlap(const radar_sensor_cfg_t &a, const radar_sensor_cfg_t &b) const;
 public:
   CRadar(uint8_t _trig_pin, uint8_t _echo_pin, uint8_t _direction_pin);
-  void echo_handler() {
-    hc_sr04.echo_handler();
-  }
-  void init(void (*pEchoHandler)(void)) {
-    hc_sr04.init(pEchoHandler);
-  }
+  CRadar(const std::vector<radar_sensor_cfg_t> &sensors);
+  bool add_sensor(const radar_sensor_cfg_t &cfg);
+  void init();
 
   bool start();
   void stop();
-  surround_t getMap() {
+  //replay: recorded sample in place of measurement
+  void inject(size_t idx, int16_t angle, int32_t distance, std::chrono::milliseconds time);
+  size_t getSensorCount() const {
+    return sensors_.size();
+  }
+  size_t getGroupCount() const {
+    return groups_.size();
+  }
+  const radar_sensor_cfg_t& getSensorCfg(size_t idx) const {
+    return sensors_[idx].cfg;
+  }
+  surround_t getMap(size_t idx = 0) {
     map_mu_.lock();
-    auto surrount = surrond_;
+    auto surrount = sensors_[idx].surround;
     map_mu_.unlock();
     return surrount;
   }
+  uint32_t getReadings() const {
+    return readings_.load(std::memory_order_relaxed);
+  }
+  float getReadingsPerSecond() const;
   virtual ~CRadar() {
     stop();
   }
     int16_t getMaxDistance() const
   {
-    return hc_sr04.MAX_DISTANCE;
+    return HC_SR04::MAX_DISTANCE;
   }
     int16_t getAngleStep() const
   {
-    return hc_sr04.MEASURING_ANGLE;
+    return HC_SR04::MEASURING_ANGLE;
   }
 
     int16_t getAngleMax() const
@@ -74,4 +122,5 @@ public:
   ;
 };
 
+void radar_bench();
 #endif /* CRADAR_H_ */
@@ -0,0 +1,129 @@
+/*
+ * CReplay.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CReplay.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+bool CReplay::load(const string &file) {
+  records_.clear();
+  expected_.clear();
+  last_output_us_ = 0;
+  const auto res = CFlightRecorder::read(file, [this](const record_t &rec) {
+    records_.push_back(rec);
+    if (is_output(rec.type)) {
+      expected_[key(rec.type, rec.channel)].push_back(rec.val.value);
+      last_output_us_ = rec.time_us;
+    }
+  });
+  if (!res) {
+    return false;
+  }
+  for (const auto &rec : records_) {
+    if ((rec.type < inputs_.size()) && inputs_[rec.type].preload && inputs_[rec.type].handler) {
+      inputs_[rec.type].handler(rec);
+    }
+  }
+  return true;
+}
+
+void CReplay::set_input(uint16_t type, const input_handler_t &handler, bool preload) {
+  if (type < inputs_.size()) {
+    inputs_[type] = {handler, preload};
+  }
+}
+
+void CReplay::on_record(const record_t &rec) {
+  if (!is_output(rec.type)) {
+    return;
+  }
+  lock_guard<mutex> guard(output_mu_);
+  const auto k = key(rec.type, rec.channel);
+  auto &pos = produced_[k];
+  const auto it = expected_.find(k);
+  if ((it == expected_.end()) || (pos >= it->second.size())) {
+    extra_++;
+  } else if (it->second[pos] == rec.val.value) {
+    matched_++;
+  } else {
+    mismatched_++;
+    if (mismatches_.size() < mismatch_max) {
+      mismatches_.push_back( { rec.type, rec.channel, pos, it->second[pos], rec.val.value });
+    }
+  }
+  pos++;
+}
+
+void CReplay::dispatch(const record_t &rec) {
+  if (rec_cmd == rec.type) {
+    cmd_.append(rec.text, strnlen(rec.text, sizeof(rec.text)));
+    if (rec.channel & rec_cmd_last) {
+      const auto sep = cmd_.find('\n');
+      if (cmd_handler_ && (sep != string::npos)) {
+        cmd_handler_(cmd_.substr(0, sep), cmd_.substr(sep + 1));
+      }
+      cmd_.clear();
+    }
+    return;
+  }
+  if ((rec.type < inputs_.size()) && !inputs_[rec.type].preload && inputs_[rec.type].handler) {
+    inputs_[rec.type].handler(rec);
+  }
+}
+
+void CReplay::run(float speed) {
+  const auto started = chrono::steady_clock::now();
+  const auto first_us = records_.empty() ? 0 : records_.front().time_us;
+  const auto wait = [&](uint64_t time_us) {
+    if (0 < speed) {
+      this_thread::sleep_until(started + chrono::microseconds(static_cast<int64_t>((time_us - first_us) / speed)));
+    }
+  };
+  const uint64_t tick_us = (tick_hz_ && tick_handler_) ? 1000000 / tick_hz_ : 0;
+  auto next_tick_us = first_us + tick_us;
+  for (const auto &rec : records_) {
+    for (; tick_us && (next_tick_us <= min(rec.time_us, last_output_us_)); next_tick_us += tick_us) {
+      wait(next_tick_us);
+      tick_handler_(tick_us / 1e6f);
+    }
+    wait(rec.time_us);
+    dispatch(rec);
+  }
+  wall_us_ = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+}
+
+size_t CReplay::missing() const {
+  size_t count = 0;
+  for (const auto &it : expected_) {
+    const auto produced = produced_.find(it.first);
+    const auto done = (produced == produced_.end()) ? 0 : produced->second;
+    if (done < it.second.size()) {
+      count += it.second.size() - done;
+    }
+  }
+  return count;
+}
+
+void CReplay::report(ostream &os) const {
+  const auto recorded_us = records_.empty() ? 0 : records_.back().time_us - records_.front().time_us;
+  os << "replay records=" << records_.size() << " recorded=" << recorded_us / 1000 << "ms wall=" << wall_us_ / 1000
+      << "ms";
+  if (wall_us_) {
+    os << " speedup=" << static_cast<float>(recorded_us) / wall_us_;
+  }
+  os << endl;
+  os << "outputs matched=" << matched_ << " mismatched=" << mismatched_ << " missing=" << missing() << " extra="
+      << extra_ << endl;
+  for (const auto &m : mismatches_) {
+    os << "  type=" << m.type << " channel=" << m.channel << " #" << m.pos << " expected=" << m.expected
+        << " produced=" << m.produced << endl;
+  }
+}
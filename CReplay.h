@@ -0,0 +1,88 @@
+/*
+ * CReplay.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CREPLAY_H_
+#define CREPLAY_H_
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <mutex>
+#include <functional>
+#include <iostream>
+#include "CFlightRecorder.h"
+
+/***
+ * replays flight recorder session: sensor records are fed to inputs,
+ * http commands are re-injected, produced pwm/motor/servo outputs are compared
+ * with the recorded ones
+ */
+class CReplay {
+public:
+  using input_handler_t = std::function<void(const record_t&)>;
+  using cmd_handler_t = std::function<void(const std::string &uri, const std::string &body)>;
+  using tick_handler_t = std::function<void(float dt)>;
+private:
+  struct input_t {
+    input_handler_t handler;
+    bool preload; //all values are given before run, for sensors read on demand
+  };
+  struct mismatch_t {
+    uint16_t type;
+    uint16_t channel;
+    size_t pos;
+    int32_t expected;
+    int32_t produced;
+  };
+  static constexpr size_t mismatch_max = 16;
+  std::vector<record_t> records_;
+  std::array<input_t, rec_type_count> inputs_;
+  cmd_handler_t cmd_handler_;
+  tick_handler_t tick_handler_;
+  uint32_t tick_hz_ = 0;
+  uint64_t last_output_us_ = 0; //session tick stopped after it
+  std::string cmd_;
+  std::mutex output_mu_;
+  //<type<<16|channel, values>
+  std::map<uint32_t, std::vector<int32_t>> expected_;
+  std::map<uint32_t, size_t> produced_;
+  size_t matched_ = 0;
+  size_t mismatched_ = 0;
+  size_t extra_ = 0;
+  std::vector<mismatch_t> mismatches_;
+  uint64_t wall_us_ = 0;
+  static bool is_output(uint16_t type) {
+    return (rec_pwm == type) || (rec_motor == type) || (rec_servo == type);
+  }
+  static uint32_t key(uint16_t type, uint16_t channel) {
+    return (static_cast<uint32_t>(type) << 16) | channel;
+  }
+  void dispatch(const record_t &rec);
+public:
+  bool load(const std::string &file);
+  void set_input(uint16_t type, const input_handler_t &handler, bool preload = false);
+  void set_cmd_handler(const cmd_handler_t &handler) {
+    cmd_handler_ = handler;
+  }
+  //actuator tick is stepped between records at recorded rate
+  void set_tick(uint32_t rate_hz, const tick_handler_t &handler) {
+    tick_hz_ = rate_hz;
+    tick_handler_ = handler;
+  }
+  //recorder tap, outputs produced by replay
+  void on_record(const record_t &rec);
+  //speed: 1 - recorded timing, 0 - as fast as possible
+  void run(float speed);
+  bool isIdentical() const {
+    return (0 == mismatched_) && (0 == extra_) && (missing() == 0);
+  }
+  size_t missing() const;
+  void report(std::ostream &os) const;
+};
+
+#endif /* CREPLAY_H_ */
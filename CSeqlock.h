@@ -0,0 +1,71 @@
+/*
+ * CSeqlock.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CSEQLOCK_H_
+#define CSEQLOCK_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+/***
+ * latest value published by one writer, read by any thread without lock.
+ * Writer never waits, reader retries while write is in progress.
+ * Value is kept in relaxed atomic words, so torn copy is discarded, not a data race.
+ */
+template<typename T>
+class CSeqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "value is copied by words");
+  static constexpr size_t words = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  std::atomic<uint32_t> seq_ { 0 }; //odd - write in progress
+  std::atomic<uint32_t> data_[words];
+  mutable std::atomic<uint32_t> retries_ { 0 };
+public:
+  CSeqlock() {
+    for (auto &word : data_) {
+      word.store(0, std::memory_order_relaxed);
+    }
+  }
+  //writer
+  void write(const T &value) {
+    uint32_t buf[words] = { };
+    memcpy(buf, &value, sizeof(T));
+    const auto seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t idx = 0; idx < words; idx++) {
+      data_[idx].store(buf[idx], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+  //false - nothing written yet
+  bool read(T &value) const {
+    uint32_t buf[words];
+    uint32_t seq;
+    for (;;) {
+      seq = seq_.load(std::memory_order_acquire);
+      if (0 == (seq & 1)) {
+        for (size_t idx = 0; idx < words; idx++) {
+          buf[idx] = data_[idx].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq == seq_.load(std::memory_order_relaxed)) {
+          break;
+        }
+      }
+      retries_.fetch_add(1, std::memory_order_relaxed);
+    }
+    memcpy(&value, buf, sizeof(T));
+    return 0 != seq;
+  }
+  uint32_t getRetries() const {
+    return retries_.load(std::memory_order_relaxed);
+  }
+};
+
+#endif /* CSEQLOCK_H_ */
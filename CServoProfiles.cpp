@@ -0,0 +1,189 @@
+/*
+ * CServoProfiles.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CServoProfiles.h"
+#include "CActuatorTick.h"
+#include <math.h>
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+constexpr float CServoProfiles::unlimited;
+CServoProfiles servo_profiles(pwm_registry);
+
+CServoProfiles::CServoProfiles(CPwmRegistry &dev) :
+    dev_(dev) {
+  for (uint16_t channel = 0; channel < channels; channel++) {
+    target_cmd_[channel].store(0, std::memory_order_relaxed);
+    position_out_[channel].store(0, std::memory_order_relaxed);
+  }
+  for (uint8_t board = 0; board < boards; board++) {
+    enabled_[board].store(0, std::memory_order_relaxed);
+    snap_[board].store(0, std::memory_order_relaxed);
+    known_[board].store(0, std::memory_order_relaxed);
+  }
+  target_.fill(0);
+  pos_.fill(0);
+  vel_.fill(0);
+  acc_.fill(0);
+  vmax_.fill(unlimited);
+  amax_.fill(unlimited);
+  jmax_.fill(unlimited);
+  jinv_.fill(0);
+  written_.fill(0);
+  changed_.fill(0);
+}
+
+void CServoProfiles::setLimits(uint16_t channel, float max_velocity, float max_acceleration, float max_jerk) {
+  if (channels <= channel) {
+    return;
+  }
+  //set before tick is started
+  vmax_[channel] = (0 < max_velocity) ? max_velocity : unlimited;
+  amax_[channel] = (0 < max_acceleration) ? max_acceleration : unlimited;
+  jmax_[channel] = (0 < max_jerk) ? max_jerk : unlimited;
+  jinv_[channel] = (0 < max_jerk) ? 1.f / max_jerk : 0;
+  enabled_[channel / CPca9685::channels].fetch_or(1 << channel % CPca9685::channels, std::memory_order_relaxed);
+}
+
+bool CServoProfiles::move(uint16_t channel, uint16_t pwm) {
+  if (channels <= channel) {
+    return false;
+  }
+  const auto board = channel / CPca9685::channels;
+  const uint16_t mask = 1 << channel % CPca9685::channels;
+  target_cmd_[channel].store(pwm, std::memory_order_relaxed);
+  const auto first = 0 == (known_[board].fetch_or(mask, std::memory_order_relaxed) & mask);
+  if (first || !isEnabled(channel) || !actuator_tick.isTicking()) { //servo position unknown or no profile
+    snap_[board].fetch_or(mask, std::memory_order_release);
+    position_out_[channel].store(pwm, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+uint32_t CServoProfiles::evaluate(float dt, uint16_t count) {
+  if (channels < count) {
+    count = channels;
+  }
+  std::array<uint16_t, boards> snap;
+  for (uint8_t board = 0; board * CPca9685::channels < count; board++) {
+    snap[board] = snap_[board].exchange(0, std::memory_order_acquire);
+  }
+  for (uint16_t channel = 0; channel < count; channel++) {
+    target_[channel] = target_cmd_[channel].load(std::memory_order_relaxed);
+  }
+  const auto inv_dt = 1.f / dt;
+  for (uint16_t channel = 0; channel < count; channel++) {
+    const auto amax = amax_[channel];
+    const auto err = target_[channel] - pos_[channel];
+    const auto dist = fabsf(err);
+    //fastest velocity which still stops at target: v^2/2a + v*a/2j = dist
+    const auto k = amax * amax * jinv_[channel];
+    const auto v_stop = 0.5f * (sqrtf(k * k + 8.f * amax * dist) - k);
+    const auto v_des = copysignf(fminf(vmax_[channel], v_stop), err);
+    //acceleration ramps down in time to reach v_des without overshoot
+    const auto dv = v_des - vel_[channel];
+    const auto a_lim = fminf(amax, sqrtf(2.f * jmax_[channel] * fabsf(dv)));
+    const auto a_des = copysignf(fminf(a_lim, fabsf(dv) * inv_dt), dv);
+    const auto da = jmax_[channel] * dt;
+    const auto acc = fmaxf(acc_[channel] - da, fminf(acc_[channel] + da, a_des));
+    const auto vel = vel_[channel] + acc * dt;
+    const auto next = pos_[channel] + vel * dt;
+    //arrived or crossed target
+    const bool done = (dist < 0.5f) || ((target_[channel] - next) * err <= 0.f)
+        || ((snap[channel / CPca9685::channels] >> channel % CPca9685::channels) & 1);
+    pos_[channel] = done ? target_[channel] : next;
+    vel_[channel] = done ? 0.f : vel;
+    acc_[channel] = done ? 0.f : acc;
+  }
+  uint32_t changed = 0;
+  for (uint8_t board = 0; board * CPca9685::channels < count; board++) {
+    uint16_t mask = 0;
+    for (uint8_t local = 0; local < CPca9685::channels; local++) {
+      const auto channel = board * CPca9685::channels + local;
+      const auto pwm = static_cast<uint16_t>(pos_[channel] + 0.5f);
+      mask |= static_cast<uint16_t>(pwm != written_[channel]) << local;
+      written_[channel] = pwm;
+    }
+    changed_[board] = mask;
+    changed += __builtin_popcount(mask);
+  }
+  return changed;
+}
+
+void CServoProfiles::step(float dt) {
+  if (0 == evaluate(dt, dev_.getChannels())) {
+    return;
+  }
+  CPwmRegistry::Batch batch(dev_);
+  for (uint8_t board = 0; board * CPca9685::channels < dev_.getChannels(); board++) {
+    const auto changed = changed_[board] & enabled_[board].load(std::memory_order_relaxed);
+    for (uint8_t local = 0; local < CPca9685::channels; local++) {
+      if (changed & (1 << local)) {
+        const auto channel = board * CPca9685::channels + local;
+        position_out_[channel].store(written_[channel], std::memory_order_relaxed);
+        dev_.set(channel, written_[channel]);
+      }
+    }
+  }
+}
+
+void servo_profile_bench() {
+  constexpr auto rate_hz = 50;
+  constexpr auto dt = 1.f / rate_hz;
+  //evaluation cost of one board and of full registry
+  CPca9685 first(0, 0x40);
+  CPwmRegistry dev(first);
+  CServoProfiles profiles(dev);
+  for (uint16_t channel = 0; channel < CServoProfiles::channels; channel++) {
+    profiles.setLimits(channel, 200, 800, (channel & 1) ? 8000 : 0);
+  }
+  constexpr auto iterations = 100000;
+  for (const auto count : { CPca9685::channels * 1, CPca9685::channels * CServoProfiles::boards }) {
+    uint32_t changed = 0;
+    const auto started = chrono::steady_clock::now();
+    for (auto iteration = 0; iteration < iterations; iteration++) {
+      if (0 == iteration % 100) { //new targets, mid move most of the time
+        for (uint16_t channel = 0; channel < count; channel++) {
+          profiles.target_cmd_[channel].store(100 + (iteration / 100 + channel) % 2 * 400, std::memory_order_relaxed);
+        }
+      }
+      changed += profiles.evaluate(dt, count);
+    }
+    const auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - started).count();
+    cout << "servo profile " << count << " channels update=" << ns / iterations << "ns tick=" << 1000000 / rate_hz
+        << "us changed=" << changed / iterations << "/tick" << endl;
+  }
+  //single move 100->500 counts, trapezoidal and s-curve
+  for (const auto jerk : { 0.f, 8000.f }) {
+    CServoProfiles move(dev);
+    move.setLimits(0, 200, 800, jerk);
+    move.target_cmd_[0].store(100, std::memory_order_relaxed);
+    move.snap_[0].store(1, std::memory_order_relaxed);
+    move.evaluate(dt, CPca9685::channels);
+    move.target_cmd_[0].store(500, std::memory_order_relaxed);
+    auto ticks = 0;
+    float vel_max = 0;
+    float acc_max = 0;
+    float prev_vel = 0;
+    while ((ticks < 1000) && (500 != move.written_[0])) {
+      move.evaluate(dt, CPca9685::channels);
+      if (500 == move.written_[0]) { //stop is snapped
+        break;
+      }
+      vel_max = fmaxf(vel_max, fabsf(move.vel_[0]));
+      acc_max = fmaxf(acc_max, fabsf(move.vel_[0] - prev_vel) / dt);
+      prev_vel = move.vel_[0];
+      ticks++;
+    }
+    ticks++;
+    cout << "servo profile " << (jerk ? "s-curve" : "trapezoid") << " 400 counts in " << ticks * 1000 / rate_hz
+        << "ms vel max=" << vel_max << " acc max=" << acc_max << endl;
+  }
+}
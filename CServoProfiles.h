@@ -0,0 +1,71 @@
+/*
+ * CServoProfiles.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CSERVOPROFILES_H_
+#define CSERVOPROFILES_H_
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include "CPwmRegistry.h"
+
+/***
+ * velocity/acceleration limited motion of pwm registry servo channels, stepped by actuator tick.
+ * jerk limit 0 - trapezoidal profile, otherwise S-curve.
+ * State is kept as structure of arrays and channels of all registered boards are evaluated
+ * without per channel branches, units are pwm counts.
+ */
+class CServoProfiles {
+public:
+  static constexpr uint8_t boards = CPwmRegistry::max_boards;
+  static constexpr uint16_t channels = boards * CPca9685::channels;
+  static constexpr float unlimited = 1e9f;
+private:
+  using lane_t = std::array<float, channels>;
+  using mask_t = std::array<std::atomic<uint16_t>, boards>; //channel mask per board
+  CPwmRegistry &dev_;
+  //written by producers
+  std::array<std::atomic<uint16_t>, channels> target_cmd_;
+  mask_t enabled_;
+  mask_t snap_; //jump to target on next step
+  mask_t known_; //position is known after first move
+  std::array<std::atomic<uint16_t>, channels> position_out_;
+  //owned by tick
+  alignas(16) lane_t target_;
+  alignas(16) lane_t pos_;
+  alignas(16) lane_t vel_;
+  alignas(16) lane_t acc_;
+  alignas(16) lane_t vmax_;
+  alignas(16) lane_t amax_;
+  alignas(16) lane_t jmax_;
+  alignas(16) lane_t jinv_; //0 - trapezoidal
+  std::array<uint16_t, channels> written_;
+  std::array<uint16_t, boards> changed_;
+public:
+  CServoProfiles(CPwmRegistry &dev);
+  //limits per second, counts
+  void setLimits(uint16_t channel, float max_velocity, float max_acceleration, float max_jerk = 0);
+  bool isEnabled(uint16_t channel) const {
+    return (channels > channel)
+        && (enabled_[channel / CPca9685::channels].load(std::memory_order_relaxed) & (1 << channel % CPca9685::channels));
+  }
+  //false: no profile or tick, caller writes pwm directly
+  bool move(uint16_t channel, uint16_t pwm);
+  //current commanded pwm
+  uint16_t getPosition(uint16_t channel) const {
+    return position_out_[channel].load(std::memory_order_relaxed);
+  }
+  //evaluates channels of registered boards, writes changed ones
+  void step(float dt);
+  //evaluation only of first count channels, returns number of changed
+  uint32_t evaluate(float dt, uint16_t count);
+  friend void servo_profile_bench();
+};
+
+extern CServoProfiles servo_profiles;
+
+void servo_profile_bench();
+#endif /* CSERVOPROFILES_H_ */
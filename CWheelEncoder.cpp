@@ -0,0 +1,49 @@
+/*
+ * CWheelEncoder.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CWheelEncoder.h"
+#ifndef _SIMULATION_
+#include <wiringPi.h>
+#endif
+#include <math.h>
+
+using namespace std;
+
+void CWheelEncoder::init(void (*pEdgeHandler)(void)) {
+#ifndef _SIMULATION_
+  pinMode(pin_, INPUT);
+  pullUpDnControl(pin_, PUD_UP);
+  wiringPiISR(pin_, INT_EDGE_BOTH, pEdgeHandler);
+#endif
+}
+
+#ifdef _SIMULATION_
+void CWheelEncoder::simulate(float dt, float drive, float voltage_scale) {
+  //friction eats deadband, full drive gives max speed
+  const auto duty = fmaxf(0, fabsf(drive) - sim_deadband) / (100 - sim_deadband);
+  const auto steady = copysignf(duty, drive) * voltage_scale * sim_max_cps;
+  sim_speed_ += (steady - sim_speed_) * fminf(1.f, dt / sim_tau);
+  sim_rest_ += fabsf(sim_speed_) * dt;
+  const auto sim_edges = static_cast<uint32_t>(sim_rest_);
+  sim_rest_ -= sim_edges;
+  edges_.fetch_add(sim_edges, std::memory_order_relaxed);
+}
+#endif
+
+int32_t CWheelEncoder::poll(float drive) {
+#ifdef _SIMULATION_
+  //model knows shaft direction, it lags drive on reverse
+  const auto forward = (0 != sim_speed_) ? (0 < sim_speed_) : (0 <= drive);
+#else
+  const auto forward = 0 <= drive;
+#endif
+  const auto edges = edges_.load(std::memory_order_relaxed);
+  const auto delta = static_cast<int32_t>(edges - last_edges_) * (forward ? 1 : -1);
+  last_edges_ = edges;
+  count_.fetch_add(delta, std::memory_order_relaxed);
+  return delta;
+}
@@ -0,0 +1,55 @@
+/*
+ * CWheelEncoder.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CWHEELENCODER_H_
+#define CWHEELENCODER_H_
+#include <stdint.h>
+#include <atomic>
+
+/***
+ * single channel wheel encoder, edges are counted in isr,
+ * direction is taken from drive sign.
+ * Simulation: first order motor model gives counts from applied drive
+ */
+class CWheelEncoder {
+  const uint8_t pin_;
+  std::atomic<uint32_t> edges_ { 0 };
+  uint32_t last_edges_ = 0;
+  std::atomic<int32_t> count_ { 0 };
+#ifdef _SIMULATION_
+  float sim_speed_ = 0; //counts/s
+  float sim_rest_ = 0; //fraction of count
+#endif
+public:
+  static constexpr float sim_max_cps = 600; //full drive at nominal battery
+  static constexpr float sim_tau = 0.15; //s
+  static constexpr float sim_deadband = 10; //%, not enough to start
+  CWheelEncoder(uint8_t pin) :
+      pin_(pin) {
+  }
+  void edge_handler() {
+    edges_.fetch_add(1, std::memory_order_relaxed);
+  }
+  void init(void (*pEdgeHandler)(void));
+#ifdef _SIMULATION_
+  /***
+   * adds edges of dt seconds of motor model
+   * drive: applied power -100..100, voltage scale: battery/nominal
+   */
+  void simulate(float dt, float drive, float voltage_scale);
+#endif
+  /***
+   * drive: applied power -100..100, gives direction
+   * ret counts since previous poll
+   */
+  int32_t poll(float drive);
+  int32_t getCount() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+};
+
+#endif /* CWHEELENCODER_H_ */
@@ -0,0 +1,211 @@
+/*
+ * CWorkspaceMap.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#include "CWorkspaceMap.h"
+#include "CManipulator.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+static constexpr char workspace_magic[8] = { 'R', 'C', 'W', 'S', 'P', 'A', 'C', 'E' };
+static constexpr uint32_t workspace_version = 2;
+
+CWorkspaceMap::file_header_t CWorkspaceMap::header() const {
+  file_header_t h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, workspace_magic, sizeof(h.magic));
+  h.version = workspace_version;
+  h.step = step_;
+  h.reach = reach_;
+  h.arm[0] = CManipulator::BackArm_mm;
+  h.arm[1] = CManipulator::ForeArm_mm;
+  h.arm[2] = CManipulator::d_Min;
+  h.arm[3] = CManipulator::d_Max;
+  h.arm[4] = CManipulator::R_offset_mm;
+  h.ik_step = ik_step_;
+  h.dims[0] = nx_;
+  h.dims[1] = ny_;
+  h.dims[2] = nz_;
+  return h;
+}
+
+void CWorkspaceMap::build(const CManipulator &arm, float step, unsigned threads) {
+  step_ = step;
+  reach_ = CManipulator::d_Max;
+  ik_step_ = arm.getIkTableStep();
+  nx_ = static_cast<int>(ceilf(2 * reach_ / step));
+  ny_ = static_cast<int>(ceilf(reach_ / step));
+  nz_ = nx_;
+  voxels_.assign(static_cast<size_t>(nx_) * ny_ * nz_, voxel_unreachable);
+  //z slices are independent, taken by workers one by one
+  atomic<int> next_slice { 0 };
+  auto worker = [&]() {
+    for (auto iz = next_slice.fetch_add(1); iz < nz_; iz = next_slice.fetch_add(1)) {
+      for (int iy = 0; iy < ny_; iy++) {
+        for (int ix = 0; ix < nx_; ix++) {
+          auto reachable = 0;
+          auto limited = 0;
+          for (int sz = 0; sz < sub_samples; sz++) {
+            for (int sy = 0; sy < sub_samples; sy++) {
+              for (int sx = 0; sx < sub_samples; sx++) {
+                const auto x = -reach_ + (ix + (sx + 0.5f) / sub_samples) * step_;
+                const auto y = (iy + (sy + 0.5f) / sub_samples) * step_;
+                const auto z = -reach_ + (iz + (sz + 0.5f) / sub_samples) * step_;
+                int16_t base;
+                int16_t shoulder;
+                int16_t elbow;
+                if (!arm.plan(x, y, z, base, shoulder, elbow)) {
+                  continue;
+                }
+                if ((0 <= shoulder) && (180 >= shoulder) && (0 <= elbow) && (180 >= elbow)) {
+                  reachable++;
+                } else {
+                  limited++;
+                }
+              }
+            }
+          }
+          auto state = voxel_unreachable;
+          if (sub_samples * sub_samples * sub_samples == reachable) {
+            state = voxel_reachable;
+          } else if (reachable) {
+            state = voxel_partial;
+          } else if (limited) {
+            state = voxel_joint_limit;
+          }
+          voxels_[index(ix, iy, iz)] = state;
+        }
+      }
+    }
+  };
+  vector<thread> workers;
+  for (unsigned idx = 1; idx < max(threads, 1u); idx++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto &thd : workers) {
+    thd.join();
+  }
+}
+
+bool CWorkspaceMap::load(const string &file, float step, float ik_step) {
+  ifstream is(file, ios::binary);
+  if (!is) {
+    return false;
+  }
+  file_header_t stored;
+  if (!is.read(reinterpret_cast<char*>(&stored), sizeof(stored))) {
+    return false;
+  }
+  //expected header for this grid and arm
+  step_ = step;
+  reach_ = CManipulator::d_Max;
+  ik_step_ = ik_step;
+  nx_ = static_cast<int>(ceilf(2 * reach_ / step));
+  ny_ = static_cast<int>(ceilf(reach_ / step));
+  nz_ = nx_;
+  const auto expected = header();
+  if (memcmp(&stored, &expected, sizeof(stored))) {
+    voxels_.clear();
+    return false;
+  }
+  voxels_.resize(static_cast<size_t>(nx_) * ny_ * nz_);
+  if (!is.read(reinterpret_cast<char*>(voxels_.data()), voxels_.size())) {
+    voxels_.clear();
+    return false;
+  }
+  return true;
+}
+
+bool CWorkspaceMap::save(const string &file) const {
+  //write aside and rename, reader never sees half file
+  const auto tmp = file + ".tmp";
+  {
+    ofstream os(tmp, ios::binary | ios::trunc);
+    const auto h = header();
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    os.write(reinterpret_cast<const char*>(voxels_.data()), voxels_.size());
+    if (!os) {
+      return false;
+    }
+  }
+  return 0 == rename(tmp.c_str(), file.c_str());
+}
+
+bool CWorkspaceMap::init(const CManipulator &arm, float step, unsigned threads, const string &file) {
+  if (("" != file) && load(file, step, arm.getIkTableStep())) {
+    cout << "workspace loaded " << file << endl;
+    return true;
+  }
+  const auto started = chrono::steady_clock::now();
+  build(arm, step, threads);
+  cout << "workspace built threads=" << threads << " "
+      << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count() << "ms" << endl;
+  if (("" != file) && !save(file)) {
+    cerr << "workspace save failed " << file << endl;
+  }
+  return true;
+}
+
+voxel_t CWorkspaceMap::get(float x, float y, float z) const {
+  if (voxels_.empty()) {
+    return voxel_unreachable;
+  }
+  const auto ix = static_cast<int>(floorf((x + reach_) / step_));
+  const auto iy = static_cast<int>(floorf(y / step_));
+  const auto iz = static_cast<int>(floorf((z + reach_) / step_));
+  if ((0 > ix) || (0 > iy) || (0 > iz) || (nx_ <= ix) || (ny_ <= iy) || (nz_ <= iz)) {
+    return voxel_unreachable;
+  }
+  return static_cast<voxel_t>(voxels_[index(ix, iy, iz)]);
+}
+
+vector<uint32_t> CWorkspaceMap::rle() const {
+  vector<uint32_t> runs;
+  for (size_t pos = 0; pos < voxels_.size();) {
+    auto end = pos + 1;
+    while ((end < voxels_.size()) && (voxels_[end] == voxels_[pos])) {
+      end++;
+    }
+    runs.push_back(voxels_[pos]);
+    runs.push_back(end - pos);
+    pos = end;
+  }
+  return runs;
+}
+
+size_t CWorkspaceMap::count(voxel_t state) const {
+  return std::count(voxels_.begin(), voxels_.end(), state);
+}
+
+void workspace_bench() {
+  constexpr auto step = 5.f;
+  CManipulator arm(4, 6, 5);
+  const auto cores = max(thread::hardware_concurrency(), 1u);
+  uint64_t single_us = 0;
+  for (auto threads = 1u; threads <= 2 * cores; threads *= 2) {
+    CWorkspaceMap map;
+    const auto started = chrono::steady_clock::now();
+    map.build(arm, step, threads);
+    const uint64_t us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+    if (1 == threads) {
+      single_us = us;
+    }
+    cout << "workspace step=" << step << "mm voxels=" << map.getDim(0) * map.getDim(1) * map.getDim(2) << " threads="
+        << threads << " " << us / 1000 << "ms speedup=" << static_cast<float>(single_us) / us << " reachable="
+        << map.count(voxel_reachable) << " partial=" << map.count(voxel_partial) << " joint_limit="
+        << map.count(voxel_joint_limit) << endl;
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * CWorkspaceMap.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef CWORKSPACEMAP_H_
+#define CWORKSPACEMAP_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+class CManipulator;
+
+enum voxel_t : uint8_t {
+  voxel_unreachable = 0,
+  voxel_partial, //some points of voxel are reachable
+  voxel_reachable,
+  voxel_joint_limit //ik solution exists, joint is out of 0..180
+};
+
+/***
+ * manipulator reachability over x,y,z voxel grid, y >= 0 (base turns 0..180).
+ * Each voxel is sampled at sub_samples^3 points, slices are computed in parallel.
+ * Cached in file, key is grid, arm geometry and ik table step
+ */
+class CWorkspaceMap {
+public:
+  static constexpr int sub_samples = 3;
+  struct file_header_t {
+    char magic[8];
+    uint32_t version;
+    float step;
+    float reach;
+    float arm[5]; //back arm, fore arm, d min, d max, R offset
+    float ik_step; //ik table grid, plan() answers from it, 0 - analytic
+    int32_t dims[3];
+  };
+private:
+  float step_ = 0;
+  float reach_ = 0;
+  float ik_step_ = 0;
+  int nx_ = 0;
+  int ny_ = 0;
+  int nz_ = 0;
+  std::vector<uint8_t> voxels_;
+  file_header_t header() const;
+  size_t index(int ix, int iy, int iz) const {
+    return (static_cast<size_t>(iz) * ny_ + iy) * nx_ + ix;
+  }
+public:
+  void build(const CManipulator &arm, float step, unsigned threads);
+  bool load(const std::string &file, float step, float ik_step);
+  bool save(const std::string &file) const;
+  //cache or build and save
+  bool init(const CManipulator &arm, float step, unsigned threads, const std::string &file);
+  bool isBuilt() const {
+    return !voxels_.empty();
+  }
+  voxel_t get(float x, float y, float z) const;
+  float getStep() const {
+    return step_;
+  }
+  float getReach() const {
+    return reach_;
+  }
+  int getDim(int axis) const {
+    return (0 == axis) ? nx_ : ((1 == axis) ? ny_ : nz_);
+  }
+  //x fastest, then y, then z; pairs of value, count
+  std::vector<uint32_t> rle() const;
+  size_t count(voxel_t state) const;
+};
+
+void workspace_bench();
+#endif /* CWORKSPACEMAP_H_ */
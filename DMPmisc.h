@@ -59,7 +59,7 @@ protected:
 };
 #endif
 
-void dmp_main();
+struct record_imu_t;
+void dmp_inject(const record_imu_t &rec);
 void dmp_dmp_test();
-void dmp_calibrate();
 #endif /* DMPMISC_H_ */
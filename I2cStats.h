@@ -0,0 +1,37 @@
+/*
+ * I2cStats.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: ominenko
+ */
+
+#ifndef I2CSTATS_H_
+#define I2CSTATS_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+constexpr uint32_t i2c_bus_hz = 400000;
+
+//bus time of one transaction: start, address byte, bytes with ack, stop
+constexpr uint32_t i2c_transaction_ns(size_t bytes) {
+  return static_cast<uint32_t>((9 * (bytes + 1) + 2) * (1000000000ull / i2c_bus_hz));
+}
+
+struct i2c_stats_t {
+  std::atomic<uint32_t> transactions { 0 };
+  std::atomic<uint32_t> bytes { 0 }; //without address
+  std::atomic<uint64_t> bus_ns { 0 };
+  void account(size_t _bytes) {
+    transactions.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(_bytes, std::memory_order_relaxed);
+    bus_ns.fetch_add(i2c_transaction_ns(_bytes), std::memory_order_relaxed);
+  }
+  void reset() {
+    transactions.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+    bus_ns.store(0, std::memory_order_relaxed);
+  }
+};
+
+#endif /* I2CSTATS_H_ */
@@ -20,6 +20,7 @@ class HC_SR04 {
 public:
   static constexpr auto MAX_DISTANCE = 4000;
   static constexpr auto MEASURING_ANGLE = 5; //degre
+  static constexpr auto BEAM_ANGLE = 30; //degre, full cone
   static constexpr auto SOUND_SPEED = 343000; //mm/sec
   HC_SR04(uint8_t _trig, uint8_t _echo) :
       pin_trig_(_trig), pin_echo_(_echo) {
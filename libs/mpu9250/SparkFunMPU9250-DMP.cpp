@@ -34,6 +34,10 @@ MPU9250_DMP::MPU9250_DMP()
 	_mSense = 6.665f; // Constant - 4915 / 32760
 	_aSense = 0.0f;   // Updated after accel FSR is set
 	_gSense = 0.0f;   // Updated after gyro FSR is set
+	_fifoPacket = 0;
+	_fifoDmp = 0;
+	_fifoSensors = 0;
+	_fifoFeatures = 0;
 }
 
 inv_error_t MPU9250_DMP::begin(void)
@@ -246,6 +250,115 @@ unsigned short MPU9250_DMP::fifoAvailable(void)
 	return (fifoH << 8 ) | fifoL;
 }
 
+unsigned short MPU9250_DMP::fifoPacketSize(void)
+{
+	_fifoPacket = 0;
+	_fifoSensors = 0;
+	_fifoFeatures = 0;
+	if (mpu_get_dmp_state(&_fifoDmp) != INV_SUCCESS)
+		return 0;
+	if (_fifoDmp)
+	{
+		_fifoFeatures = dmpGetEnabledFeatures();
+		if (_fifoFeatures & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT))
+			_fifoPacket += 16;
+		if (_fifoFeatures & DMP_FEATURE_SEND_RAW_ACCEL)
+			_fifoPacket += 6;
+		if (_fifoFeatures & (DMP_FEATURE_SEND_RAW_GYRO | DMP_FEATURE_SEND_CAL_GYRO))
+			_fifoPacket += 6;
+		if (_fifoFeatures & (DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT))
+			_fifoPacket += 4;
+		return _fifoPacket;
+	}
+	if (mpu_get_fifo_config(&_fifoSensors) != INV_SUCCESS)
+		return 0;
+	if (_fifoSensors & INV_XYZ_ACCEL)
+		_fifoPacket += 6;
+	if (_fifoSensors & INV_X_GYRO)
+		_fifoPacket += 2;
+	if (_fifoSensors & INV_Y_GYRO)
+		_fifoPacket += 2;
+	if (_fifoSensors & INV_Z_GYRO)
+		_fifoPacket += 2;
+	return _fifoPacket;
+}
+
+inv_error_t MPU9250_DMP::readFifoBurst(unsigned char * data, unsigned short maxPackets,
+                                       unsigned short * packets)
+{
+	if (!fifoPacketSize())
+		return INV_ERROR;
+	if (mpu_read_fifo_burst(_fifoPacket, maxPackets, data, packets) != INV_SUCCESS)
+		return INV_ERROR;
+	return INV_SUCCESS;
+}
+
+static short fifo_short(const unsigned char * data)
+{
+	return (short)((data[0] << 8) | data[1]);
+}
+
+static long fifo_long(const unsigned char * data)
+{
+	return ((long)data[0] << 24) | ((long)data[1] << 16) | ((long)data[2] << 8) | data[3];
+}
+
+bool MPU9250_DMP::decodeFifo(const unsigned char * packet)
+{
+	if (_fifoDmp)
+	{
+		if (_fifoFeatures & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT))
+		{
+			qw = fifo_long(packet);
+			qx = fifo_long(packet + 4);
+			qy = fifo_long(packet + 8);
+			qz = fifo_long(packet + 12);
+			packet += 16;
+			// Same check as dmp_read_fifo: magnitude in q28 must be near 1
+			long long magSq = 0;
+			const long q14[4] = { qw >> 16, qx >> 16, qy >> 16, qz >> 16 };
+			for (int i = 0; i < 4; i++)
+				magSq += (long long)q14[i] * q14[i];
+			if ((magSq < (1L << 28) - (1L << 24)) || (magSq > (1L << 28) + (1L << 24)))
+				return false;
+		}
+		if (_fifoFeatures & DMP_FEATURE_SEND_RAW_ACCEL)
+		{
+			ax = fifo_short(packet);
+			ay = fifo_short(packet + 2);
+			az = fifo_short(packet + 4);
+			packet += 6;
+		}
+		if (_fifoFeatures & (DMP_FEATURE_SEND_RAW_GYRO | DMP_FEATURE_SEND_CAL_GYRO))
+		{
+			gx = fifo_short(packet);
+			gy = fifo_short(packet + 2);
+			gz = fifo_short(packet + 4);
+		}
+		return true;
+	}
+	if (_fifoSensors & INV_XYZ_ACCEL)
+	{
+		ax = fifo_short(packet);
+		ay = fifo_short(packet + 2);
+		az = fifo_short(packet + 4);
+		packet += 6;
+	}
+	if (_fifoSensors & INV_X_GYRO)
+	{
+		gx = fifo_short(packet);
+		packet += 2;
+	}
+	if (_fifoSensors & INV_Y_GYRO)
+	{
+		gy = fifo_short(packet);
+		packet += 2;
+	}
+	if (_fifoSensors & INV_Z_GYRO)
+		gz = fifo_short(packet);
+	return true;
+}
+
 inv_error_t MPU9250_DMP::updateFifo(void)
 {
 	short gyro[3], accel[3];
@@ -589,6 +702,21 @@ inv_error_t MPU9250_DMP::dmpSetPedometerTime(unsigned long time)
 	return dmp_set_pedometer_walk_time(time);
 }
 
+inv_error_t MPU9250_DMP::dmpSetInterruptMode(unsigned char mode)
+{
+	return dmp_set_interrupt_mode(mode);
+}
+
+inv_error_t MPU9250_DMP::dmpSetGyroBias(long * bias)
+{
+	return dmp_set_gyro_bias(bias);
+}
+
+inv_error_t MPU9250_DMP::dmpSetAccelBias(long * bias)
+{
+	return dmp_set_accel_bias(bias);
+}
+
 float MPU9250_DMP::calcAccel(int axis)
 {
 	return (float) axis / (float) _aSense;
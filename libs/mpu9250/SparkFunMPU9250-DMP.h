@@ -226,6 +226,18 @@ public:
 	// resetFifo -- Resets the FIFO's read/write pointers
 	// Output: INV_SUCCESS (0) on success, otherwise error
 	inv_error_t resetFifo(void);
+	// fifoPacketSize -- Returns bytes of one FIFO packet for current FIFO
+	// or DMP configuration, and latches the layout used by decodeFifo
+	unsigned short fifoPacketSize(void);
+	// readFifoBurst -- Reads all whole packets from the FIFO (up to maxPackets)
+	// with one FIFO count read and as few block reads as possible
+	// Output: INV_SUCCESS (0) on success, otherwise error
+	inv_error_t readFifoBurst(unsigned char * data, unsigned short maxPackets,
+	                          unsigned short * packets);
+	// decodeFifo -- Parses one packet read by readFifoBurst into ax, ay, az,
+	// gx, gy, gz and qw, qx, qy, qz
+	// Output: false if DMP quaternion is not normalized (FIFO is misaligned)
+	bool decodeFifo(const unsigned char * packet);
 	
 	// enableInterrupt -- Configure the MPU-9250's interrupt output to indicate
 	// when new data is ready.
@@ -391,6 +403,10 @@ public:
 private:
 	unsigned short _aSense;
 	float _gSense, _mSense;
+	// FIFO packet layout, set by fifoPacketSize
+	unsigned short _fifoPacket;
+	unsigned char _fifoDmp, _fifoSensors;
+	unsigned short _fifoFeatures;
 	
 	// Convert a QN-format number to a float
 	float qToFloat(long number, unsigned char q);
@@ -1778,6 +1778,52 @@ int mpu_read_fifo_stream(unsigned short length, unsigned char *data,
     return 0;
 }
 
+/**
+ *  @brief      Get all whole unparsed packets from the FIFO.
+ *  FIFO count is read once, data is read in chunks of MAX_FIFO_BURST bytes
+ *  (i2c_read length is one byte). Works with and without DMP.
+ *  @param[in]  packet_size Length of one FIFO packet.
+ *  @param[in]  max_packets Capacity of data, packets.
+ *  @param[out] data        FIFO packets.
+ *  @param[out] packets     Number of packets read.
+ *  @return     0 if successful, -2 if FIFO overflowed and was reset.
+ */
+int mpu_read_fifo_burst(unsigned short packet_size, unsigned short max_packets,
+    unsigned char *data, unsigned short *packets)
+{
+    unsigned char tmp[2];
+    unsigned short fifo_count, length, pos;
+    packets[0] = 0;
+    if (!st.chip_cfg.sensors || !packet_size)
+        return -1;
+
+    if (i2c_read(st.hw->addr, st.reg->fifo_count_h, 2, tmp))
+        return -1;
+    fifo_count = (tmp[0] << 8) | tmp[1];
+    if (fifo_count > (st.hw->max_fifo >> 1)) {
+        /* FIFO is 50% full, better check overflow bit. */
+        if (i2c_read(st.hw->addr, st.reg->int_status, 1, tmp))
+            return -1;
+        if (tmp[0] & BIT_FIFO_OVERFLOW) {
+            mpu_reset_fifo();
+            return -2;
+        }
+    }
+    packets[0] = fifo_count / packet_size;
+    if (packets[0] > max_packets)
+        packets[0] = max_packets;
+    length = packets[0] * packet_size;
+    for (pos = 0; pos < length; pos += MAX_FIFO_BURST) {
+        unsigned char chunk = (length - pos < MAX_FIFO_BURST) ? length - pos : MAX_FIFO_BURST;
+        if (i2c_read(st.hw->addr, st.reg->fifo_r_w, chunk, data + pos)) {
+            packets[0] = pos / packet_size; /* rest stays in FIFO misaligned */
+            mpu_reset_fifo();
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /**
  *  @brief      Set device to bypass mode.
  *  @param[in]  bypass_on   1 to enable bypass mode.
@@ -116,6 +116,9 @@ int mpu_read_fifo(short *gyro, short *accel, unsigned long *timestamp,
     unsigned char *sensors, unsigned char *more);
 int mpu_read_fifo_stream(unsigned short length, unsigned char *data,
     unsigned char *more);
+#define MAX_FIFO_BURST  (252)  /* one i2c_read, whole 12 and 28 byte packets */
+int mpu_read_fifo_burst(unsigned short packet_size, unsigned short max_packets,
+    unsigned char *data, unsigned short *packets);
 int mpu_reset_fifo(void);
 
 int mpu_write_mem(unsigned short mem_addr, unsigned short length,
@@ -16,75 +16,25 @@ Supported Platforms:
 - ATSAMD21 (Arduino Zero, SparkFun SAMD21 Breakouts)
 ******************************************************************************/
 #include "arduino_mpu9250_i2c.h"
-#ifndef _SIMULATION_
-#include <sys/ioctl.h>
-#include <asm/ioctl.h>
-#include <linux/i2c-dev.h>
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
+#include "CI2cBus.h"
 
-static int _fd = -1;
-static bool init(unsigned char slave_addr)
+// MPU-9250 and AK8963 in bypass mode share this bus
+#define MPU9250_I2C_BUS     (1)
+
+static CI2cBus& bus()
 {
-    if (-1 == _fd)
-    {
-        _fd = wiringPiI2CSetup(slave_addr);
-    }
-    return (_fd != -1);
+    static CI2cBus &mpu_bus = i2c_bus(MPU9250_I2C_BUS);
+    return mpu_bus;
 }
 
 int arduino_i2c_write(unsigned char slave_addr, unsigned char reg_addr,
         unsigned char length, unsigned char *data)
 {
-    if (false == init(slave_addr))
-    {
-        return -1;
-    }
-
-    return i2c_smbus_write_i2c_block_data(_fd, slave_addr, length, data);
+    return bus().writeReg(slave_addr, reg_addr, data, length, i2c_imu);
 }
 
 int arduino_i2c_read(unsigned char slave_addr, unsigned char reg_addr,
         unsigned char length, unsigned char *data)
 {
-    if (false == init(slave_addr))
-    {
-        return -1;
-    }
-
-    return i2c_smbus_read_i2c_block_data(_fd, reg_addr, length, data);
-}
-
-#else
-int arduino_i2c_write(unsigned char slave_addr, unsigned char reg_addr,
-                       unsigned char length, unsigned char * data)
-{
-//    Wire.beginTransmission(slave_addr);
-//    Wire.write(reg_addr);
-//    for (unsigned char i = 0; i < length; i++)
-//    {
-//        Wire.write(data[i]);
-//    }
-//    Wire.endTransmission(true);
-//
-    return 0;
+    return bus().readReg(slave_addr, reg_addr, data, length, i2c_imu);
 }
-
-int arduino_i2c_read(unsigned char slave_addr, unsigned char reg_addr,
-                       unsigned char length, unsigned char * data)
-{
-//    Wire.beginTransmission(slave_addr);
-//    Wire.write(reg_addr);
-//    Wire.endTransmission(false);
-//    Wire.requestFrom(slave_addr, length);
-//    for (unsigned char i = 0; i < length; i++)
-//    {
-//        data[i] = Wire.read();
-//    }
-//
-    return 0;
-}
-
-
-#endif
-
@@ -1,14 +1,34 @@
 SOURCES += rcbrowser.cpp
 SOURCES += CDCmotor.cpp
+SOURCES += CWheelEncoder.cpp
+SOURCES += CMotorController.cpp
+SOURCES += CDiffDrive.cpp
 SOURCES += pca9685Servo.cpp
+SOURCES += CPca9685.cpp
+SOURCES += CPwmRegistry.cpp
+SOURCES += CActuatorTick.cpp
+SOURCES += CServoProfiles.cpp
+SOURCES += CAnimator.cpp
 SOURCES += hc_sr04.cpp
 SOURCES += CManipulator.cpp
+SOURCES += CIkTable.cpp
+SOURCES += CArmPath.cpp
+SOURCES += CWorkspaceMap.cpp
 SOURCES += CRadar.cpp
 SOURCES += CHttpCmdHandler.cpp
 SOURCES += DMPmisc.cpp
+SOURCES += CImu.cpp
+SOURCES += CAhrs.cpp
+SOURCES += CImuCalib.cpp
 SOURCES += CPower.cpp
 SOURCES += joystick.cpp
+SOURCES += CFlightRecorder.cpp
+SOURCES += CReplay.cpp
+SOURCES += CI2cBus.cpp
+SOURCES += CI2cProfile.cpp
+SOURCES += CI2cSim.cpp
 
 CFLAGS += -I../rapidjson/include/
+CFLAGS += -I.
 
 include ./libs/module.mk
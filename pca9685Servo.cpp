@@ -6,16 +6,13 @@
  */
 
 #include "pca9685Servo.h"
-#ifndef _SIMULATION_
-#include <wiringPi.h>
-#include "pca9685.h"
-#endif
+#include "CFlightRecorder.h"
+#include "CPwmRegistry.h"
+#include "CServoProfiles.h"
 #include <iostream>
 #include <string>
-#include <mutex>
 
 using namespace std;
-mutex mu;
 
 pca9685_Servo::pca9685_Servo(uint8_t _pin) :
     pca9685_Servo(_pin, 0, 100) {
@@ -41,31 +38,58 @@ uint16_t pca9685_Servo::val_to_pwm(int16_t val) const {
   return minPulse + static_cast<int32_t>(maxPulse - minPulse) * (val - minVal) / (maxVal - minVal);
 }
 
+int16_t pca9685_Servo::pwm_to_val(uint16_t pwm) const {
+  return minVal + (static_cast<int32_t>(pwm - minPulse) * (maxVal - minVal) * 2 + (maxPulse - minPulse))
+      / (2 * (maxPulse - minPulse));
+}
+
+void pca9685_Servo::setProfile(float max_speed, float max_acceleration, float max_jerk) {
+  const auto counts = static_cast<float>(maxPulse - minPulse) / (maxVal - minVal);
+  servo_profiles.setLimits(pin_, max_speed * counts, max_acceleration * counts, max_jerk * counts);
+}
+
+int16_t pca9685_Servo::getVal() const {
+  const auto val = val_.load();
+  if ((INT16_MIN == val) || !servo_profiles.isEnabled(pin_)) {
+    return val;
+  }
+  return pwm_to_val(servo_profiles.getPosition(pin_));
+}
+
 void pca9685_Servo::setVal(int16_t val) {
-  lock_guard<mutex> guard(mu);
   if (val <= minVal) {
     val = minVal;
   }
   if (val >= maxVal) {
     val = maxVal;
   }
-  if (val_ != val) {
-    val_ = val;
-    set_PWM(val_to_pwm(val));
+  if (val_.exchange(val) == val) {
+    return;
+  }
+  flight_recorder.value(rec_servo, pin_, val);
+  //concurrent setVal may queue its write before ours, last writer resends current value
+  for (;;) {
+    const auto pwm = val_to_pwm(val);
+    if (!servo_profiles.move(pin_, pwm)) { //no profile, jump
+      set_PWM(pwm);
+    }
+    const auto current = val_.load();
+    if (current == val) {
+      return;
+    }
+    val = current;
   }
 }
 
-void pca9685_Servo::set_PWM(uint8_t pin, uint16_t pulse) {
+void pca9685_Servo::set_PWM(uint16_t channel, uint16_t pulse) {
 
   if (maxPWM < pulse) {
     pulse = maxPWM;
   }
 #ifdef LOG_INFO
-  cout << __FILE__ << ":" << __LINE__ << "(" << __FUNCTION__ << ")  pca[" << static_cast<int>(pin) << "]="
+  cout << __FILE__ << ":" << __LINE__ << "(" << __FUNCTION__ << ")  pca[" << channel << "]="
   << pulse << endl;
 #endif
-#ifndef _SIMULATION_
-  pwmWrite(300 + pin, pulse);
-#endif
+  pwm_registry.set(channel, pulse);
 }
 //endif;
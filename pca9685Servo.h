@@ -8,6 +8,7 @@
 #ifndef PCA9685SERVO_H_
 #define PCA9685SERVO_H_
 #include <stdint.h>
+#include <atomic>
 //http://en.wikipedia.org/wiki/Servo_control#Pulse_duration
 
 class pca9685_Servo {
@@ -16,8 +17,9 @@ class pca9685_Servo {
   const int16_t maxVal;
   const uint16_t minPulse;
   const uint16_t maxPulse;
-  int16_t val_;
+  std::atomic<int16_t> val_ { INT16_MIN }; //not written yet
   uint16_t val_to_pwm(int16_t val) const;
+  int16_t pwm_to_val(uint16_t pwm) const;
 public:
   static constexpr auto maxPWM = 0xfff + 1;
   const uint16_t angle_time = .12 * 1000 / 60; // time for rotate on 1 degry SG90
@@ -26,14 +28,15 @@ public:
   pca9685_Servo(uint8_t _pin, int16_t _minVal, int16_t _maxVal, uint16_t _minPulse, uint16_t _maxPulse);
   void init(int16_t init_val);
   void init();
+  //limits in val units per second, jerk 0 - trapezoidal profile
+  void setProfile(float max_speed, float max_acceleration, float max_jerk = 0);
   void setVal(int16_t val);
-  int16_t getVal() const {
-    return val_;
-  }
+  //commanded position, moves toward last set value when profile is set
+  int16_t getVal() const;
   void set_PWM(uint16_t pulse) {
     set_PWM(pin_, pulse);
   }
-  static void set_PWM(uint8_t pin, uint16_t pulse);
+  static void set_PWM(uint16_t channel, uint16_t pulse);
 };
 
 #endif /* PCA9685SERVO_H_ */
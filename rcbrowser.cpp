@@ -9,10 +9,6 @@ static struct mg_serve_http_opts s_http_server_opts;
 
 CRadar radar { radar_trig_pin, radar_echo_pin, radar_dir_pin_pca };
 
-void ultrasonic0_echo_handler() {
-  radar.echo_handler();
-}
-
 pca9685_Servo chasis_camer(pca_pin_chasis_cameraY, 0, 100, pwm_chasis_camera_min, pwm_chasis_camera_max);
 CHttpCmdHandler http_cmd_handler;
 //MPU6050_DMP_func mpu6050;
@@ -48,7 +44,7 @@ bool handle_config(const rapidjson::Document &d, rapidjson::Document &reply) {
 bool handle_test(const rapidjson::Document &d, rapidjson::Document &reply) {
 
   if (d.HasMember("pwm")) {
-    const uint8_t pin = d["pwm"].GetInt();
+    const uint16_t pin = d["pwm"].GetInt();
     const uint16_t value = d["value"].GetInt();
     pca9685_Servo::set_PWM(pin, value);
     return true;
@@ -56,52 +52,38 @@ bool handle_test(const rapidjson::Document &d, rapidjson::Document &reply) {
   return false;
 }
 
+/***
+ * latest orientation snapshot, reading never blocks imu thread
+ */
 bool handle_mpu6050(const rapidjson::Document &d, rapidjson::Document &reply) {
-    /*
-  if (!mpu6050.isInited()) {
+  imu_state_t state;
+  if (!imu.getState(state)) {
     return false;
   }
   auto &allocator = reply.GetAllocator();
-  array<float, 3> yaw_pitch_roll;
-  VectorFloat accel;
-  VectorFloat pos;
-  VectorFloat speed;
-  Quaternion q;
-  mpu6050.get(yaw_pitch_roll.data(), accel, q, pos, speed);
-      ;
-  rapidjson::Value ypr(rapidjson::kObjectType);
-  ypr.AddMember("yaw", yaw_pitch_roll[0], allocator);
-  ypr.AddMember("pitch", yaw_pitch_roll[1], allocator);
-  ypr.AddMember("roll", yaw_pitch_roll[2], allocator);
-
-  reply.AddMember("ypr", ypr, allocator);
-
-  rapidjson::Value aworld(rapidjson::kObjectType);
-  aworld.AddMember("x", accel.x, allocator);
-  aworld.AddMember("y", accel.y, allocator);
-  aworld.AddMember("z", accel.z, allocator);
-  reply.AddMember("accel", aworld, allocator);
-
-  rapidjson::Value speed_g(rapidjson::kObjectType);
-  speed_g.AddMember("x", speed.x, allocator);
-  speed_g.AddMember("y", speed.y, allocator);
-  speed_g.AddMember("z", speed.z, allocator);
-  reply.AddMember("speed", speed_g, allocator);
-
+  reply.AddMember("time_us", state.time_us, allocator);
+  reply.AddMember("samples", state.samples, allocator);
+  reply.AddMember("source", rapidjson::Value((imu_source_ahrs == state.source) ? "ahrs" : "dmp", allocator),
+      allocator);
+  reply.AddMember("yaw", state.yaw, allocator);
+  reply.AddMember("pitch", state.pitch, allocator);
+  reply.AddMember("roll", state.roll, allocator);
+  rapidjson::Value accel(rapidjson::kObjectType);
+  accel.AddMember("x", state.linear_accel[0], allocator);
+  accel.AddMember("y", state.linear_accel[1], allocator);
+  accel.AddMember("z", state.linear_accel[2], allocator);
+  reply.AddMember("accel", accel, allocator);
+  rapidjson::Value gyro(rapidjson::kObjectType);
+  gyro.AddMember("x", state.gyro[0], allocator);
+  gyro.AddMember("y", state.gyro[1], allocator);
+  gyro.AddMember("z", state.gyro[2], allocator);
+  reply.AddMember("gyro", gyro, allocator);
   rapidjson::Value quaternion(rapidjson::kObjectType);
-  quaternion.AddMember("x", q.x, allocator);
-  quaternion.AddMember("y", q.y, allocator);
-  quaternion.AddMember("z", q.z, allocator);
-  quaternion.AddMember("w", q.w, allocator);
+  quaternion.AddMember("w", state.quat[0], allocator);
+  quaternion.AddMember("x", state.quat[1], allocator);
+  quaternion.AddMember("y", state.quat[2], allocator);
+  quaternion.AddMember("z", state.quat[3], allocator);
   reply.AddMember("quaternion", quaternion, allocator);
-
-  rapidjson::Value position(rapidjson::kObjectType);
-  position.AddMember("x", pos.x, allocator);
-  position.AddMember("y", pos.y, allocator);
-  position.AddMember("z", pos.z, allocator);
-  reply.AddMember("position", position, allocator);
-
-     */
   return true;
 }
 
@@ -112,6 +94,173 @@ bool handle_status(const rapidjson::Document &d, rapidjson::Document &reply) {
   return true;
 }
 
+bool handle_metrics(const rapidjson::Document &d, rapidjson::Document &reply) {
+  auto &allocator = reply.GetAllocator();
+  rapidjson::Value radar_metrics(rapidjson::kObjectType);
+  radar_metrics.AddMember("sensors", static_cast<unsigned>(radar.getSensorCount()), allocator);
+  radar_metrics.AddMember("readings", radar.getReadings(), allocator);
+  radar_metrics.AddMember("readings_per_second", radar.getReadingsPerSecond(), allocator);
+  reply.AddMember("radar", radar_metrics, allocator);
+
+  rapidjson::Value pwm(rapidjson::kArrayType);
+  for (size_t idx = 0; idx < pwm_registry.getBoards(); idx++) {
+    const auto &board = pwm_registry.getBoard(idx);
+    const auto &stats = board.getStats();
+    rapidjson::Value metrics(rapidjson::kObjectType);
+    metrics.AddMember("bus", board.getBus(), allocator);
+    metrics.AddMember("address", board.getAddress(), allocator);
+    metrics.AddMember("transactions", stats.transactions.load(), allocator);
+    metrics.AddMember("bytes", stats.bytes.load(), allocator);
+    metrics.AddMember("bus_us", static_cast<uint64_t>(stats.bus_ns.load() / 1000), allocator);
+    metrics.AddMember("shadow_hits", board.getShadowHits(), allocator);
+    metrics.AddMember("shadow_misses", board.getShadowMisses(), allocator);
+    metrics.AddMember("commands", board.getCommands(), allocator);
+    metrics.AddMember("queue_full", board.getQueueFull(), allocator);
+    pwm.PushBack(metrics, allocator);
+  }
+  reply.AddMember("pwm", pwm, allocator);
+
+  rapidjson::Value i2c(rapidjson::kArrayType);
+  i2c_buses([&i2c, &allocator](CI2cBus &bus) {
+    rapidjson::Value metrics(rapidjson::kObjectType);
+    metrics.AddMember("bus", bus.getBus(), allocator);
+    metrics.AddMember("scheduled", bus.isRunning(), allocator);
+    metrics.AddMember("transfers", bus.getTransfers(), allocator);
+    metrics.AddMember("errors", bus.getErrors(), allocator);
+    for (uint8_t idx = 0; idx < i2c_classes; idx++) {
+      const auto cls = static_cast<i2c_class_t>(idx);
+      rapidjson::Value val(rapidjson::kObjectType);
+      val.AddMember("ops", bus.getOps(cls), allocator);
+      val.AddMember("merged", bus.getMerged(cls), allocator);
+      val.AddMember("latency_avg_us", bus.getLatencyAvgNs(cls) / 1000, allocator);
+      val.AddMember("latency_max_us", bus.getLatencyMaxNs(cls) / 1000, allocator);
+      metrics.AddMember(rapidjson::Value(i2c_class_name(cls), allocator), val, allocator);
+    }
+    i2c.PushBack(metrics, allocator);
+  });
+  reply.AddMember("i2c", i2c, allocator);
+
+  rapidjson::Value tick(rapidjson::kObjectType);
+  tick.AddMember("running", actuator_tick.isRunning(), allocator);
+  tick.AddMember("rate_hz", actuator_tick.getRate(), allocator);
+  tick.AddMember("ticks", actuator_tick.getTicks(), allocator);
+  tick.AddMember("overruns", actuator_tick.getOverruns(), allocator);
+  tick.AddMember("jitter_avg_us", actuator_tick.getJitterAvgNs() / 1000, allocator);
+  tick.AddMember("jitter_max_us", actuator_tick.getJitterMaxNs() / 1000, allocator);
+  tick.AddMember("work_max_us", actuator_tick.getWorkMaxNs() / 1000, allocator);
+  reply.AddMember("tick", tick, allocator);
+
+  rapidjson::Value motors(rapidjson::kObjectType);
+  motors.AddMember("cycles", motor_controller.getCycles(), allocator);
+  motors.AddMember("rate_hz", motor_controller.getCycleRate(), allocator);
+  motors.AddMember("cpu_avg_ns", motor_controller.getCpuAvgNs(), allocator);
+  motors.AddMember("cpu_max_ns", motor_controller.getCpuMaxNs(), allocator);
+  motors.AddMember("voltage_scale", motor_controller.getVoltageScale(), allocator);
+  rapidjson::Value channels(rapidjson::kArrayType);
+  for (size_t idx = 0; idx < motor_controller.getCount(); idx++) {
+    rapidjson::Value val(rapidjson::kObjectType);
+    val.AddMember("target", motor_controller.getTarget(idx), allocator);
+    val.AddMember("output", motor_controller.getOutput(idx), allocator);
+    val.AddMember("closed_loop", motor_controller.isClosedLoop(idx), allocator);
+    val.AddMember("speed_cps", motor_controller.getSpeed(idx), allocator);
+    val.AddMember("count", motor_controller.getCount(idx), allocator);
+    channels.PushBack(val, allocator);
+  }
+  motors.AddMember("channels", channels, allocator);
+  reply.AddMember("motors", motors, allocator);
+
+  rapidjson::Value imu_metrics(rapidjson::kObjectType);
+  imu_metrics.AddMember("ready", imu.isReady(), allocator);
+  imu_metrics.AddMember("rate_hz", imu.getRate(), allocator);
+  imu_metrics.AddMember("samples", imu.getSamples(), allocator);
+  imu_metrics.AddMember("errors", imu.getErrors(), allocator);
+  imu_metrics.AddMember("int_pin", imu.getIntPin(), allocator);
+  imu_metrics.AddMember("irqs", imu.getIrqs(), allocator);
+  imu_metrics.AddMember("wakeups", imu.getWakeups(), allocator);
+  imu_metrics.AddMember("state_retries", imu.getStateRetries(), allocator);
+  reply.AddMember("imu", imu_metrics, allocator);
+  rapidjson::Value ahrs_metrics(rapidjson::kObjectType);
+  ahrs_metrics.AddMember("updates", ahrs.getUpdates(), allocator);
+  ahrs_metrics.AddMember("no_mag", ahrs.getNoMag(), allocator);
+  ahrs_metrics.AddMember("accel_rejected", ahrs.getAccelRejected(), allocator);
+  ahrs_metrics.AddMember("error", ahrs.getError(), allocator);
+  ahrs_metrics.AddMember("beta", ahrs.getBeta(), allocator);
+  reply.AddMember("ahrs", ahrs_metrics, allocator);
+  rapidjson::Value calib_metrics(rapidjson::kObjectType);
+  calib_metrics.AddMember("still", imu_calib.isStill(), allocator);
+  calib_metrics.AddMember("windows", imu_calib.getWindows(), allocator);
+  calib_metrics.AddMember("moving", imu_calib.getMoving(), allocator);
+  rapidjson::Value gyro_bias(rapidjson::kArrayType);
+  rapidjson::Value accel_bias(rapidjson::kArrayType);
+  for (auto axis = 0; axis < 3; axis++) {
+    gyro_bias.PushBack(imu_calib.getGyroBias(axis), allocator);
+    accel_bias.PushBack(imu_calib.getAccelBias(axis), allocator);
+  }
+  calib_metrics.AddMember("gyro_bias", gyro_bias, allocator);
+  calib_metrics.AddMember("accel_bias", accel_bias, allocator);
+  reply.AddMember("imu_calib", calib_metrics, allocator);
+  return true;
+}
+
+static rapidjson::Value i2c_counters_json(const i2c_counters_t &counters, rapidjson::Document::AllocatorType &allocator) {
+  rapidjson::Value val(rapidjson::kObjectType);
+  val.AddMember("reads", counters.reads.load(), allocator);
+  val.AddMember("writes", counters.writes.load(), allocator);
+  val.AddMember("errors", counters.errors.load(), allocator);
+  val.AddMember("bytes", counters.bytes.load(), allocator);
+  val.AddMember("wire_us", counters.wire_ns.load() / 1000, allocator);
+  val.AddMember("latency_avg_us", counters.getLatencyAvgNs() / 1000, allocator);
+  val.AddMember("latency_max_us", counters.latency_max_ns.load() / 1000, allocator);
+  rapidjson::Value histogram(rapidjson::kArrayType);
+  for (const auto &bucket : counters.histogram) {
+    histogram.PushBack(bucket.load(), allocator);
+  }
+  val.AddMember("histogram", histogram, allocator);
+  return val;
+}
+
+//i2c traffic per bus, device and register; "reset": true restarts counters after reply
+static bool handle_debug_i2c(const rapidjson::Document &d, rapidjson::Document &reply) {
+  auto &allocator = reply.GetAllocator();
+  rapidjson::Value bounds(rapidjson::kArrayType);
+  for (size_t bucket = 0; bucket + 1 < i2c_counters_t::buckets; bucket++) {
+    bounds.PushBack(i2c_counters_t::bucket_us(bucket), allocator);
+  }
+  reply.AddMember("histogram_us", bounds, allocator);
+  reply.AddMember("window_ms", CI2cProfile::slot_ms * static_cast<uint32_t>(CI2cProfile::window_slots), allocator);
+  const auto reset = d.HasMember("reset") && d["reset"].GetBool();
+  rapidjson::Value buses(rapidjson::kArrayType);
+  i2c_buses([&buses, &allocator, reset](CI2cBus &bus) {
+    auto &profile = bus.getProfile();
+    rapidjson::Value val(rapidjson::kObjectType);
+    val.AddMember("bus", bus.getBus(), allocator);
+    val.AddMember("busy_utilization", profile.getBusyUtilization(), allocator);
+    val.AddMember("wire_utilization", profile.getWireUtilization(), allocator);
+    val.AddMember("dropped", profile.getDropped(), allocator);
+    rapidjson::Value devices(rapidjson::kArrayType);
+    profile.devices([&devices, &allocator](uint8_t address, const i2c_counters_t &counters) {
+      auto device = i2c_counters_json(counters, allocator);
+      device.AddMember("address", address, allocator);
+      devices.PushBack(device, allocator);
+    });
+    val.AddMember("devices", devices, allocator);
+    rapidjson::Value registers(rapidjson::kArrayType);
+    profile.registers([&registers, &allocator](uint8_t address, uint8_t reg, const i2c_counters_t &counters) {
+      auto val = i2c_counters_json(counters, allocator);
+      val.AddMember("address", address, allocator);
+      val.AddMember("register", reg, allocator);
+      registers.PushBack(val, allocator);
+    });
+    val.AddMember("registers", registers, allocator);
+    buses.PushBack(val, allocator);
+    if (reset) {
+      profile.reset();
+    }
+  });
+  reply.AddMember("buses", buses, allocator);
+  return true;
+}
+
 static bool handle_chasiscamera(const rapidjson::Document &d, rapidjson::Document &reply) {
   if (d.HasMember("Y")) {
     const auto y = d["Y"].GetInt();
@@ -154,19 +303,76 @@ static bool handle_chasisradar(const rapidjson::Document &d, rapidjson::Document
     values.PushBack(val, allocator);
   }
   reply.AddMember("radar", values, allocator);
+  //fixed sensors, last reading of each
+  rapidjson::Value sensors(rapidjson::kArrayType);
+  for (size_t idx = 1; idx < radar.getSensorCount(); idx++) {
+    const auto &cfg = radar.getSensorCfg(idx);
+    const auto map = radar.getMap(idx);
+    if (map.empty()) {
+      continue;
+    }
+    rapidjson::Value val(rapidjson::kObjectType);
+    val.AddMember("id", static_cast<unsigned>(idx), allocator);
+    val.AddMember("mount", cfg.mount_angle, allocator);
+    val.AddMember("angl", map.begin()->first, allocator);
+    val.AddMember("time", static_cast<int64_t>(map.begin()->second.first.count()), allocator);
+    val.AddMember("dist", map.begin()->second.second, allocator);
+    sensors.PushBack(val, allocator);
+  }
+  reply.AddMember("sensors", sensors, allocator);
+  reply.AddMember("readings", radar.getReadingsPerSecond(), allocator);
   return true;
 }
 
 CDCmotor motorL0(pca_pin_chasis_motor_l_g, pca_pin_chasis_motor_l_p);
 CDCmotor motorR0(pca_pin_chasis_motor_r_p, pca_pin_chasis_motor_r_g);
+CMotorController motor_controller(&power);
+constexpr motor_cfg_t wheel_motor_cfg = { 200, 0.05, 0.1, 0, CWheelEncoder::sim_max_cps };
+#ifdef _SIMULATION_
+constexpr diff_drive_cfg_t chasis_drive_cfg = { 130, 500, CWheelEncoder::sim_max_cps / 500 };
+#else
+constexpr diff_drive_cfg_t chasis_drive_cfg = { 130, 500, 0 };
+#endif
+CDiffDrive diff_drive(motor_controller, motor_l0, motor_r0, chasis_drive_cfg);
 bool handle_wheels(const rapidjson::Document &d, rapidjson::Document &reply) {
   const int16_t wheel_L0 = d["wheel_L0"].GetInt();
   const int16_t wheel_R0 = d["wheel_R0"].GetInt();
 
   cout << "wheel=" << wheel_L0 << ":" << wheel_R0;
   cout << endl;
-  motorL0.set(wheel_L0);
-  motorR0.set(wheel_R0);
+  CPwmRegistry::Batch batch(pwm_registry); //both wheels in one block write
+  motor_controller.set(motor_l0, wheel_L0);
+  motor_controller.set(motor_r0, wheel_R0);
+  return true;
+}
+
+static void add_pose(const pose_t &pose, rapidjson::Document &reply) {
+  auto &allocator = reply.GetAllocator();
+  rapidjson::Value val(rapidjson::kObjectType);
+  val.AddMember("x", pose.x, allocator);
+  val.AddMember("y", pose.y, allocator);
+  val.AddMember("theta", pose.theta, allocator);
+  val.AddMember("v", pose.v, allocator);
+  val.AddMember("w", pose.w, allocator);
+  val.AddMember("time", pose.time_us, allocator);
+  reply.AddMember("pose", val, allocator);
+}
+
+//linear mm/s, angular rad/s
+bool handle_drive(const rapidjson::Document &d, rapidjson::Document &reply) {
+  if (!d.HasMember("linear") || !d.HasMember("angular")) {
+    return false;
+  }
+  diff_drive.drive(d["linear"].GetFloat(), d["angular"].GetFloat());
+  add_pose(diff_drive.getPose(), reply);
+  return true;
+}
+
+bool handle_pose(const rapidjson::Document &d, rapidjson::Document &reply) {
+  if (d.HasMember("reset") && d["reset"].GetBool()) {
+    diff_drive.resetPose();
+  }
+  add_pose(diff_drive.getPose(), reply);
   return true;
 }
 
@@ -175,6 +381,7 @@ constexpr auto pin_elbow = 5;
 constexpr auto pin_shoulder = 6;
 
 CManipulator manipulator(pin_manipulator_base, pin_shoulder, pin_elbow);
+CWorkspaceMap workspace;
 
 bool handle_manipulator(const rapidjson::Document &d, rapidjson::Document &reply) {
 
@@ -199,6 +406,117 @@ bool handle_manipulator(const rapidjson::Document &d, rapidjson::Document &reply
   return false;
 }
 
+/***
+ * {"points":[{"x","y","z" mm,"t" ms from start}...], "blend": ms} - start path,
+ * {"cancel":true} - stop, empty - progress only
+ */
+bool handle_manipulator_path(const rapidjson::Document &d, rapidjson::Document &reply) {
+  if (d.HasMember("cancel") && d["cancel"].GetBool()) {
+    manipulator.cancel_path();
+  }
+  if (d.HasMember("points")) {
+    const auto &points = d["points"];
+    if (!points.IsArray() || !actuator_tick.isTicking()) { //path is stepped by tick only
+      return false;
+    }
+    vector<waypoint_t> path;
+    for (rapidjson::SizeType idx = 0; idx < points.Size(); idx++) {
+      const auto &point = points[idx];
+      path.push_back( { point["x"].GetFloat(), point["y"].GetFloat(), point["z"].GetFloat(), point["t"].GetUint() });
+    }
+    const auto blend = d.HasMember("blend") ? d["blend"].GetUint() : 0;
+    if (!manipulator.start_path(path, blend)) {
+      return false;
+    }
+  }
+  static const char *const state_names[] = { "idle", "running", "done", "cancelled" };
+  const auto progress = manipulator.getProgress();
+  auto &allocator = reply.GetAllocator();
+  rapidjson::Value state(state_names[progress.state], allocator);
+  reply.AddMember("state", state, allocator);
+  reply.AddMember("elapsed", progress.elapsed, allocator);
+  reply.AddMember("duration", progress.duration, allocator);
+  reply.AddMember("segment", static_cast<unsigned>(progress.segment), allocator);
+  reply.AddMember("segments", static_cast<unsigned>(progress.segments), allocator);
+  reply.AddMember("unreachable", progress.unreachable, allocator);
+  return true;
+}
+
+/***
+ * {"x","y","z"} - state of point, empty - whole grid run length encoded
+ * state: 0 - unreachable, 1 - partial, 2 - reachable, 3 - joint limit
+ */
+bool handle_manipulator_workspace(const rapidjson::Document &d, rapidjson::Document &reply) {
+  if (!workspace.isBuilt()) {
+    return false;
+  }
+  auto &allocator = reply.GetAllocator();
+  if (d.HasMember("x") && d.HasMember("y") && d.HasMember("z")) {
+    reply.AddMember("state", static_cast<unsigned>(workspace.get(d["x"].GetFloat(), d["y"].GetFloat(),
+        d["z"].GetFloat())), allocator);
+    return true;
+  }
+  reply.AddMember("step", workspace.getStep(), allocator);
+  rapidjson::Value origin(rapidjson::kArrayType);
+  origin.PushBack(-workspace.getReach(), allocator);
+  origin.PushBack(0, allocator);
+  origin.PushBack(-workspace.getReach(), allocator);
+  reply.AddMember("origin", origin, allocator);
+  rapidjson::Value dims(rapidjson::kArrayType);
+  for (auto axis = 0; axis < 3; axis++) {
+    dims.PushBack(workspace.getDim(axis), allocator);
+  }
+  reply.AddMember("dims", dims, allocator);
+  rapidjson::Value runs(rapidjson::kArrayType);
+  for (const auto val : workspace.rle()) {
+    runs.PushBack(val, allocator);
+  }
+  reply.AddMember("rle", runs, allocator);
+  return true;
+}
+
+/***
+ * {"play":name,"loop","fade_ms","speed"}, {"stop":name,"fade_ms"} - "" stops all,
+ * {"reload":true} - clips of animation folder are loaded again
+ */
+bool handle_animation(const rapidjson::Document &d, rapidjson::Document &reply) {
+  if (d.HasMember("reload") && d["reload"].GetBool()) {
+    animator.reload();
+  }
+  if (d.HasMember("stop")) {
+    animator.stop(d["stop"].GetString(), d.HasMember("fade_ms") ? d["fade_ms"].GetUint() : 0);
+  }
+  if (d.HasMember("play")) {
+    if (!actuator_tick.isTicking()) {
+      return false;
+    }
+    const auto loop = d.HasMember("loop") && d["loop"].GetBool();
+    const auto fade_ms = d.HasMember("fade_ms") ? d["fade_ms"].GetUint() : 0;
+    const auto speed = d.HasMember("speed") ? d["speed"].GetFloat() : 1.f;
+    if (!animator.play(d["play"].GetString(), loop, fade_ms, speed)) {
+      return false;
+    }
+  }
+  auto &allocator = reply.GetAllocator();
+  rapidjson::Value clips(rapidjson::kArrayType);
+  for (const auto &name : animator.getClips()) {
+    clips.PushBack(rapidjson::Value(name.c_str(), allocator), allocator);
+  }
+  reply.AddMember("clips", clips, allocator);
+  rapidjson::Value playing(rapidjson::kArrayType);
+  for (const auto &playback : animator.getPlaying()) {
+    rapidjson::Value item(rapidjson::kObjectType);
+    item.AddMember("name", rapidjson::Value(playback.name.c_str(), allocator), allocator);
+    item.AddMember("time", playback.time, allocator);
+    item.AddMember("duration", playback.duration, allocator);
+    item.AddMember("weight", playback.weight, allocator);
+    item.AddMember("loop", playback.loop, allocator);
+    playing.PushBack(item, allocator);
+  }
+  reply.AddMember("playing", playing, allocator);
+  return true;
+}
+
 enum {
   http_err_Ok = 200,
   http_err_BadRequest = 400,
@@ -245,6 +563,7 @@ void command_handler(struct mg_connection *nc, struct http_message *hm, const CH
   rapidjson::Document part_reply;
   part_reply.SetObject();
   auto callback_ = get_uri_callback(hm->query_string);
+  flight_recorder.cmd(hm->uri.p, hm->uri.len, hm->body.p, hm->body.len);
   do {
     print(hm->body);
     string json;
@@ -311,25 +630,89 @@ static void ev_handler(struct mg_connection *nc, int ev, void *ev_data) {
 }
 
 
-#define PIN_BASE 300
 #define HERTZ 50
 
 void init() {
 #ifndef _SIMULATION_
-  int fd = 0;
     //  wiringPiSetup();
   wiringPiSetupGpio(); //use broadcom naming
-  fd = pca9685Setup(PIN_BASE, 0x40, HERTZ);
-  pca9685PWMReset(fd);
     wiringPiI2CSetup(1);
 #endif
+  pwm_registry.init(HERTZ);
   power.init();
-  motorR0.init();
-  motorL0.init();
+  motor_controller.init();
   chasis_camer.init();
-  radar.init(ultrasonic0_echo_handler);
+  radar.init();
   manipulator.init();
-    radar.start();
+}
+
+static void add_tick_handlers() {
+  actuator_tick.add([](float dt) {
+    servo_profiles.step(dt);
+    animator.step(dt); //clip channels override profiles
+  });
+  actuator_tick.add([](float dt) {
+    motor_controller.step(dt);
+    diff_drive.step(dt);
+  });
+  actuator_tick.add([](float dt) {
+    manipulator.step(dt);
+  });
+}
+
+static int replay_main(const string &file, float speed) {
+  CFlightRecorder::file_header_t header;
+  if (!CFlightRecorder::read_header(file, header)) {
+    cerr << "not a recorder file " << file << endl;
+    return 1;
+  }
+  CReplay replay;
+  replay.set_input(rec_power, [](const record_t &rec) {
+    power.inject(rec.channel, rec.val.value);
+  }, true);
+  replay.set_input(rec_radar, [](const record_t &rec) {
+    radar.inject(rec.channel, rec.radar.angle, rec.radar.distance, chrono::milliseconds(rec.time_us / 1000));
+  });
+  replay.set_input(rec_imu, [](const record_t &rec) {
+    dmp_inject(rec.imu);
+  });
+  replay.set_cmd_handler([](const string &uri, const string &body) {
+    auto handler = http_cmd_handler.get_cmd_handler(uri);
+    if (!handler) {
+      return;
+    }
+    rapidjson::Document part_cmd;
+    rapidjson::Document part_reply;
+    part_reply.SetObject();
+    if (body.length()) {
+      if (part_cmd.Parse(body.c_str()).HasParseError()) {
+        return;
+      }
+    } else {
+      part_cmd.SetObject();
+    }
+    (*handler)(part_cmd, part_reply);
+  });
+  if (!replay.load(file)) {
+    return 1;
+  }
+  power.set_replay(true);
+  flight_recorder.set_tap([&replay](const record_t &rec) {
+    replay.on_record(rec);
+  });
+  init(); //radar is not started, samples come from record
+  if (header.tick_hz) {
+    add_tick_handlers();
+    actuator_tick.startStepped(header.tick_hz);
+    replay.set_tick(header.tick_hz, [](float dt) {
+      actuator_tick.step(dt);
+    });
+  }
+  replay.run(speed);
+  actuator_tick.stop();
+  flight_recorder.set_tap(nullptr);
+  replay.report(cout);
+  return replay.isIdentical() ? 0 : 2;
 }
 
 
@@ -338,12 +721,167 @@ int main(int argc, char *argv[]) {
   bool is_demon_mode;
   string frontend_folder = "";
   string http_port = "8000";
+  vector<string> radar_sensors;
+  string record_file = "";
+  uint32_t record_seconds = 600;
+  string export_file = "";
+  uint32_t export_seconds = 0;
+  string replay_file = "";
+  float replay_speed = 0;
+  uint32_t tick_hz = HERTZ; //one frame per pca9685 output period
+  int tick_priority = 0;
+  bool tick_mlock = false;
+  string wheel_encoders = "";
+  vector<string> pwm_boards;
+  float motor_slew = wheel_motor_cfg.slew;
+  float wheel_counts_per_mm = chasis_drive_cfg.counts_per_mm;
+  float ik_table_step = 0;
+  float workspace_step = 5;
+  string workspace_cache = "workspace.bin";
+  string animation_folder = "";
+  uint16_t imu_rate = 100;
+  bool imu_dmp = false;
+  int imu_int = CImu::no_int;
+  float ahrs_beta = CAhrs::default_beta;
+  string ahrs_compare_file = "";
+  string imu_calib_file = "imu_calib.bin";
+  bool i2c_direct = false;
+  int i2c_priority = 0;
+#ifdef _SIMULATION_
+  int sim_i2c_latency = -1;
+#endif
+  string bench_name = "";
+  const map<string, function<void()>> benches = {
+    { "radar", radar_bench },
+    { "pwm", pwm_bench },
+    { "pwm_contention", pwm_contention_bench },
+    { "pwm_boards", pwm_boards_bench },
+    { "tick", tick_bench },
+    { "servo_profile", servo_profile_bench },
+    { "motor", motor_bench },
+    { "ik", ik_bench },
+    { "arm_path", arm_path_bench },
+    { "workspace", workspace_bench },
+    { "animation", animation_bench },
+    { "imu_fifo", imu_fifo_bench },
+    { "ahrs", ahrs_bench },
+    { "imu_state", imu_state_bench },
+    { "imu_calib", imu_calib_bench },
+    { "i2c_sched", i2c_sched_bench },
+    { "i2c_profile", i2c_profile_bench },
+    { "i2c_sim", i2c_sim_bench },
+  };
   app.add_flag("-d", is_demon_mode, "demon mode");
   //app.add_option("-f", frontend_folder, "frontend_folder")->check(CLI::ExistingDirectory);
   app.add_option("-f", frontend_folder, "frontend_folder");
   app.add_option("-p", http_port, "http_port");
+  app.add_option("--radar-sensor", radar_sensors, "fixed ultrasonic sensor trig:echo:mount_angle");
+  app.add_option("--bench", bench_name, "run benchmark and exit");
+  app.add_option("--record", record_file, "flight recorder file");
+  app.add_option("--record-seconds", record_seconds, "flight recorder depth, seconds at configured imu and tick rates");
+  app.add_option("--export", export_file, "export flight recorder file as csv and exit");
+  app.add_option("--export-seconds", export_seconds, "export only last seconds before newest record");
+  app.add_option("--replay", replay_file, "replay flight recorder session, compare outputs and exit");
+  app.add_option("--replay-speed", replay_speed, "1 - recorded timing, 0 - as fast as possible");
+  app.add_option("--pwm-board", pwm_boards, "chained pca9685 board bus:address, channels follow previous board");
+  app.add_option("--tick-hz", tick_hz, "actuator tick rate, 0 - write on each command");
+  app.add_option("--tick-priority", tick_priority, "actuator tick SCHED_FIFO priority, 0 - normal");
+  app.add_flag("--mlock", tick_mlock, "lock process memory");
+  app.add_option("--wheel-encoders", wheel_encoders, "wheel encoder gpio left:right, enables speed loop");
+  app.add_option("--motor-slew", motor_slew, "motor target ramp, %/s");
+  app.add_option("--wheel-counts-per-mm", wheel_counts_per_mm, "wheel encoder counts per mm, for odometry");
+  app.add_option("--ik-table", ik_table_step, "manipulator inverse kinematics table grid step mm, 0 - analytic");
+  app.add_option("--workspace-step", workspace_step, "manipulator reachability voxel mm, 0 - no map");
+  app.add_option("--workspace-cache", workspace_cache, "manipulator reachability cache file");
+  app.add_option("--animation", animation_folder, "folder of keyframe clips *.anim");
+  app.add_option("--imu-rate", imu_rate, "imu sample rate, Hz, 0 - no imu");
+  app.add_flag("--imu-dmp", imu_dmp, "imu quaternion from DMP");
+  app.add_option("--imu-int", imu_int, "gpio wired to imu INT, data ready wakes imu thread");
+  app.add_option("--imu-calib", imu_calib_file, "imu bias file, learned when robot stands still, \"\" - not kept");
+  app.add_flag("--i2c-direct", i2c_direct, "i2c devices access bus from own threads, no bus manager");
+  app.add_option("--i2c-priority", i2c_priority, "i2c bus manager SCHED_FIFO priority, 0 - normal");
+#ifdef _SIMULATION_
+  app.add_option("--sim-i2c-latency", sim_i2c_latency, "simulated i2c transfer cost over wire time, us, -1 - no bus time");
+#endif
+  app.add_option("--ahrs-beta", ahrs_beta, "orientation filter gain, rad/s");
+  app.add_option("--ahrs-compare", ahrs_compare_file, "run orientation filter over flight recorder file, compare with DMP and exit");
 
   CLI11_PARSE(app, argc, argv);
+  if (("" != replay_file) && ("" != record_file)) {
+    cerr << "--record with --replay would record replayed outputs" << endl;
+    return 1;
+  }
+
+#ifdef _SIMULATION_
+  i2c_sim_robot();
+  if (0 <= sim_i2c_latency) {
+    i2c_buses([sim_i2c_latency](CI2cBus &bus) {
+      bus.setBusDelay(true);
+      bus.setLatency(sim_i2c_latency * 1000);
+    });
+  }
+#endif
+  if ("" != bench_name) {
+    auto bench = benches.find(bench_name);
+    if (bench == benches.end()) {
+      cerr << "unknown bench " << bench_name << endl;
+      return 1;
+    }
+    bench->second();
+    return 0;
+  }
+  if ("" != export_file) {
+    return CFlightRecorder::export_csv(export_file, cout, export_seconds * 1000000ull) ? 0 : 1;
+  }
+  ahrs.setBeta(ahrs_beta);
+  if ("" != ahrs_compare_file) {
+    return ahrs_compare(ahrs_compare_file, imu.getAccelSens(), imu.getGyroSens(), ahrs_beta, cout) ? 0 : 1;
+  }
+  for (const auto &sensor : radar_sensors) {
+    unsigned trig, echo;
+    int mount;
+    if ((3 != sscanf(sensor.c_str(), "%u:%u:%d", &trig, &echo, &mount))
+        || !radar.add_sensor( { static_cast<uint8_t>(trig), static_cast<uint8_t>(echo), static_cast<int16_t>(mount),
+            CRadar::no_servo })) {
+      cerr << "wrong radar sensor " << sensor << endl;
+      return 1;
+    }
+  }
+  for (const auto &board : pwm_boards) {
+    unsigned bus;
+    int address;
+    int first = -1;
+    if ((2 != sscanf(board.c_str(), "%u:%i", &bus, &address))
+        || (0 > (first = pwm_registry.add(static_cast<uint8_t>(bus), static_cast<uint8_t>(address))))) {
+      cerr << "wrong pwm board " << board << endl;
+      return 1;
+    }
+#ifdef _SIMULATION_
+    sim_pca9685(static_cast<uint8_t>(bus), static_cast<uint8_t>(address));
+    if (0 <= sim_i2c_latency) {
+      i2c_bus(bus).setBusDelay(true);
+      i2c_bus(bus).setLatency(sim_i2c_latency * 1000);
+    }
+#endif
+    cout << "pwm board " << board << " channels " << first << ".." << first + CPca9685::channels - 1 << endl;
+  }
+
+  {
+    int encoder_l = CMotorController::no_encoder;
+    int encoder_r = CMotorController::no_encoder;
+    if (("" != wheel_encoders) && (2 != sscanf(wheel_encoders.c_str(), "%d:%d", &encoder_l, &encoder_r))) {
+      cerr << "wrong wheel encoders " << wheel_encoders << endl;
+      return 1;
+    }
+    auto cfg = wheel_motor_cfg;
+    cfg.slew = motor_slew;
+    motor_controller.add(motorL0, cfg, encoder_l);
+    motor_controller.add(motorR0, cfg, encoder_r);
+    auto drive_cfg = chasis_drive_cfg;
+    drive_cfg.counts_per_mm = wheel_counts_per_mm;
+    diff_drive.setCfg(drive_cfg);
+  }
+  manipulator.useIkTable(ik_table_step);
 
   if ("" == frontend_folder) { //use current dir
     char cwd[PATH_MAX];
@@ -366,9 +904,16 @@ int main(int argc, char *argv[]) {
   http_cmd_handler.add("/test", handle_test);
   http_cmd_handler.add("/chasiscamera", handle_chasiscamera);
   http_cmd_handler.add("/wheels", handle_wheels);
+  http_cmd_handler.add("/drive", handle_drive);
+  http_cmd_handler.add("/pose", handle_pose);
   http_cmd_handler.add("/manipulator", handle_manipulator);
+  http_cmd_handler.add("/manipulator/path", handle_manipulator_path);
+  http_cmd_handler.add("/manipulator/workspace", handle_manipulator_workspace);
+  http_cmd_handler.add("/animation", handle_animation);
   http_cmd_handler.add("/chasisradar", handle_chasisradar);
   http_cmd_handler.add("/status", handle_status);
+  http_cmd_handler.add("/metrics", handle_metrics);
+  http_cmd_handler.add("/debug/i2c", handle_debug_i2c);
   http_cmd_handler.add("/mpu6050", handle_mpu6050);
   http_cmd_handler.add("/config", handle_config);
 
@@ -377,16 +922,44 @@ int main(int argc, char *argv[]) {
     daemonize();
   }
 
+  if ("" != replay_file) {
+    return replay_main(replay_file, replay_speed);
+  }
+  if (("" != record_file)
+      && !flight_recorder.open(record_file, record_seconds, CFlightRecorder::records_per_second(imu_rate, tick_hz))) {
+    return 1;
+  }
+  flight_recorder.setTickRate(tick_hz);
+  if (!i2c_direct) {
+    i2c_bus(1).start(i2c_priority);
+    for (size_t idx = 0; idx < pwm_registry.getBoards(); idx++) {
+      i2c_bus(pwm_registry.getBoard(idx).getBus()).start(i2c_priority);
+    }
+  }
   init();
+  if (0 < workspace_step) {
+    workspace.init(manipulator, workspace_step, thread::hardware_concurrency(), workspace_cache);
+  }
+  if ("" != animation_folder) {
+    cout << "animation clips " << animator.load(animation_folder) << endl;
+  }
+  if (tick_hz) {
+    add_tick_handlers();
+    if (!actuator_tick.start(tick_hz, tick_priority, tick_mlock)) {
+      cerr << "actuator tick not started, outputs are written on each command" << endl;
+    }
+  }
+  radar.start();
 
   cout << "Number of threads = " << thread::hardware_concurrency() << endl;
-#if 1
-    dmp_main();
-#else
-  //MPU6050_main();
-  //MPU6050_dmp_test();
-  auto gyro_thread = std::thread([]() {mpu6050.main();});
-  //auto gyro_thread = std::thread(MPU6050_calibrate);
+  if (imu_rate) {
+    imu.attach(ahrs);
+    if (imu_calib.load(imu_calib_file)) {
+      cout << "imu calibration loaded " << imu_calib_file << endl;
+    }
+    imu.attach(imu_calib);
+    imu.start(imu_rate, imu_dmp, imu_int);
+  }
 
   struct mg_mgr mgr;
   struct mg_connection *nc;
@@ -412,8 +985,8 @@ int main(int argc, char *argv[]) {
   cout << "Starting RESTful server" << endl;
   for (;;) {
     mg_mgr_poll(&mgr, 1000);
+    imu_calib.service();
   }
   mg_mgr_free(&mgr);
-#endif
   return 0;
 }
@@ -23,6 +23,12 @@
 #include "pca9685.h"
 #endif
 #include "CDCmotor.h"
+#include "CMotorController.h"
+#include "CDiffDrive.h"
+#include "CPwmRegistry.h"
+#include "CActuatorTick.h"
+#include "CServoProfiles.h"
+#include "CAnimator.h"
 #include "pca9685Servo.h"
 #include <map>
 #include <unistd.h>
@@ -31,10 +37,16 @@
 #include "demonize.h"
 #include "hc_sr04.h"
 #include "CManipulator.h"
+#include "CWorkspaceMap.h"
 #include "CRadar.h"
 #include "CHttpCmdHandler.h"
 #include "DMPmisc.h"
+#include "CImu.h"
 #include "CPower.h"
+#include "CI2cBus.h"
+#include "CI2cSim.h"
+#include "CFlightRecorder.h"
+#include "CReplay.h"
 
 
 auto frontend_home = static_cast<string>("");
@@ -52,6 +64,9 @@ constexpr auto pca_pin_chasis_motor_r_g = 2;
 constexpr auto pca_pin_chasis_motor_r_p = 3;
 constexpr auto pca_pin_chasis_motor_l_g = 0;
 constexpr auto pca_pin_chasis_motor_l_p = 1;
+//motor_controller indexes
+constexpr size_t motor_l0 = 0;
+constexpr size_t motor_r0 = 1;
 
 
 #endif /* RCBROWSER_H_ */